@@ -0,0 +1,5 @@
+#version 330 core
+
+// The depth pre-pass only writes the depth (the colour writes are masked) so there is nothing to compute here
+void main(){
+}
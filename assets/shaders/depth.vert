@@ -0,0 +1,29 @@
+#version 330 core
+
+layout(location = 0) in vec3 position;
+
+//the per-frame constants are uploaded once per frame by the renderer into a uniform buffer (std140 layout)
+layout(std140) uniform FrameConstants {
+    mat4 view;
+    mat4 projection;
+    mat4 VP;
+    vec3 cameraPosition;
+    float time;
+    vec3 ambient_light;
+    int directional_light_count;
+    ivec3 cluster_count;
+    float cluster_depth_scale;
+    vec2 cluster_tile_size;
+    float cluster_depth_bias;
+};
+
+uniform mat4 objectToWorld;
+
+// This shader is used by the depth pre-pass of the renderer to only write the depth of the opaque objects.
+// The colour pass then compares the depth with GL_EQUAL, so the position must be computed exactly as in the
+// material vertex shaders (same expression and "invariant") or the depth would not match bit for bit.
+invariant gl_Position;
+
+void main(){
+    gl_Position = VP * vec4((objectToWorld * vec4(position, 1.0f)).xyz, 1.0);
+}
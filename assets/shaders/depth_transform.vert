@@ -0,0 +1,13 @@
+#version 330 core
+
+layout(location = 0) in vec3 position;
+
+uniform mat4 transform;
+
+// This is the same as "depth.vert" but it is used for the materials whose shader receives the full transform
+// (e.g. "tinted.vert" and "textured.vert") so that the depth is computed the same way
+invariant gl_Position;
+
+void main(){
+    gl_Position = transform * vec4(position, 1.0);
+}
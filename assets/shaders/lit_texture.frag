@@ -57,10 +57,29 @@ struct Light {
 #define TYPE_POINT          0
 #define TYPE_DIRECTIONAL    1
 #define TYPE_SPOT           2
-#define MAX_LIGHT_COUNT     16
+//the number of texels (vec4) used by each light in "light_data" (it must match the LightData struct of the renderer)
+#define LIGHT_TEXELS        6
 
-uniform Light lights[MAX_LIGHT_COUNT];
-uniform int light_count;
+//the lights are uploaded once per frame by the renderer into a texture buffer (the directional lights come first).
+//the point and spot lights are binned into clusters (screen tiles x depth slices) and each fragment only loops over the lights of its cluster:
+//"cluster_lights" holds the offset and the count of the lights of each cluster in "cluster_light_indices"
+uniform samplerBuffer light_data;
+uniform usamplerBuffer cluster_lights;
+uniform usamplerBuffer cluster_light_indices;
+//the per-frame constants are uploaded once per frame by the renderer into a uniform buffer (std140 layout)
+layout(std140) uniform FrameConstants {
+    mat4 view;
+    mat4 projection;
+    mat4 VP;
+    vec3 cameraPosition;
+    float time;
+    vec3 ambient_light;
+    int directional_light_count;
+    ivec3 cluster_count;
+    float cluster_depth_scale;
+    vec2 cluster_tile_size;
+    float cluster_depth_bias;
+};
 uniform TexturedMaterial tex_material;
 uniform sampler2D tex;
 
@@ -68,6 +87,78 @@ out vec4 frag_color;
 
 uniform vec4 tint;
 
+//reads the light at the given index from "light_data" (see the LightData struct of the renderer for the layout)
+Light readLight(int index){
+   int texel = index * LIGHT_TEXELS;
+   vec4 data0 = texelFetch(light_data, texel);
+   vec4 data1 = texelFetch(light_data, texel + 1);
+   vec4 data2 = texelFetch(light_data, texel + 2);
+   vec4 data3 = texelFetch(light_data, texel + 3);
+   vec4 data4 = texelFetch(light_data, texel + 4);
+   vec4 data5 = texelFetch(light_data, texel + 5);
+   Light light;
+   light.position = data0.xyz;
+   light.type = int(data0.w);
+   light.diffuse = data1.xyz;
+   light.attenuation_constant = data1.w;
+   light.specular = data2.xyz;
+   light.attenuation_linear = data2.w;
+   light.ambient = data3.xyz;
+   light.attenuation_quadratic = data3.w;
+   light.direction = data4.xyz;
+   light.inner_angle = data4.w;
+   light.outer_angle = data5.x;
+   return light;
+}
+
+//returns the offset and the count of the lights of the cluster that contains this fragment
+uvec2 readCluster(vec3 world){
+   //the tile comes from the pixel position and the slice from the view depth (the slices are exponentially spaced)
+   float depth = max(-(view * vec4(world, 1.0)).z, 1e-4);
+   int slice = clamp(int(floor(log(depth) * cluster_depth_scale + cluster_depth_bias)), 0, cluster_count.z - 1);
+   ivec2 tile = clamp(ivec2(gl_FragCoord.xy / cluster_tile_size), ivec2(0), cluster_count.xy - 1);
+   return texelFetch(cluster_lights, tile.x + cluster_count.x * (tile.y + cluster_count.y * slice)).rg;
+}
+
+//returns the diffuse and specular light reflected by the material from the given light
+//(the ambient light does not depend on the light position so it is added once for all the lights in main)
+vec3 computeLight(Light light, Material material, vec3 normal, vec3 view){
+   vec3 light_direction;
+   //set initial value for attenuation as no attenuation in directional light
+   float attenuation = 1;
+   if(light.type == TYPE_DIRECTIONAL)
+      light_direction = light.direction;
+   else {
+      //for point and spot lights we calculate the light direction
+      light_direction = fsin.world - light.position;
+      //length function returns sqrt(x[0]^2 + x[1]^2 + ......);
+      float distance = length(light_direction);
+      //getting unit vector that has the same direction of the light
+      light_direction /= distance;
+      //calculating flactuations in intensity due to the distance from light source
+      attenuation *= 1.0f / (light.attenuation_constant +
+                     light.attenuation_linear * distance +
+                     light.attenuation_quadratic * distance * distance);
+      if(light.type == TYPE_SPOT){
+         //for spot lights get inner and outer cone -> add thyeir effect to the attenuation
+         float angle = acos(dot(light.direction, light_direction));
+         attenuation *= smoothstep(light.outer_angle, light.inner_angle, angle);
+      }
+   }
+   //reflect function takes (incident, normal) and returns the reflection direction calculated as I - 2.0 * dot(N, I) * N
+   //For the function to work correctly normal vector must be normalized, thus initially we normalized the vector above
+   vec3 reflected = reflect(light_direction, normal);
+   //calculate lambert and phong factors
+   float lambert = max(0.0f, dot(normal, -light_direction));
+   float phong = pow(max(0.0f, dot(view, reflected)), material.shininess);
+   //As cclor= M.ambient * I.ambient + M.diffuse * I.diffuse * lambert + M.specular * I.specular * phong
+   //so color = ambient + diffuse + specular
+   vec3 diffuse = material.diffuse * light.ambient * lambert;
+   vec3 specular = material.specular * light.ambient * phong;
+   //taking attenuation factor into consideration
+   return (diffuse + specular) * attenuation;
+}
+
 void main(){
     ////////////////////////////////////////////////////////////////////////////////////////////
     //Normalize normal and view vectors
@@ -75,8 +166,6 @@ void main(){
    vec3 normal = normalize(fsin.normal);
    vec3 view = normalize(fsin.view);
 
-   //ensuring that the light sources doesn't exceed the maximum count
-   int count = min(light_count, MAX_LIGHT_COUNT);
    //creating an instance of material to sample from the textures according to the tex_coord
    Material material;
    //albedo is used to set the value of diffuse
@@ -96,47 +185,15 @@ void main(){
    //starting the light with emissive value so as when their is no light the emissive is rendered correctly
    vec3 accumulated_light = emissive;
 
-   //looping over the light sources
-   for(int index = 0; index < count; index++){
-      Light light = lights[index];
-      vec3 light_direction;
-      //set initial value for attenuation as no attenuation in directional light
-      float attenuation = 1;
-      if(light.type == TYPE_DIRECTIONAL)
-         light_direction = light.direction;
-      else {
-         //for point and spot lights we calculate the light direction
-         light_direction = fsin.world - light.position;
-         //length function returns sqrt(x[0]^2 + x[1]^2 + ......);
-         float distance = length(light_direction);
-         //getting unit vector that has the same direction of the light
-         light_direction /= distance;
-         //calculating flactuations in intensity due to the distance from light source
-         attenuation *= 1.0f / (light.attenuation_constant +
-                        light.attenuation_linear * distance +
-                        light.attenuation_quadratic * distance * distance);
-         if(light.type == TYPE_SPOT){
-            //for spot lights get inner and outer cone -> add thyeir effect to the attenuation
-            float angle = acos(dot(light.direction, light_direction));
-            attenuation *= smoothstep(light.outer_angle, light.inner_angle, angle);
-         }
-      }
-      //reflect function takes (incident, normal) and returns the reflection direction calculated as I - 2.0 * dot(N, I) * N
-      //For the function to work correctly normal vector must be normalized, thus initially we normalized the vector above
-      vec3 reflected = reflect(light_direction, normal);
-      //calculate lambert and phong factors
-      float lambert = max(0.0f, dot(normal, -light_direction));
-      float phong = pow(max(0.0f, dot(view, reflected)), material.shininess);
-      //As cclor= M.ambient * I.ambient + M.diffuse * I.diffuse * lambert + M.specular * I.specular * phong
-      //so color = ambient + diffuse + specular
-      vec3 diffuse = material.diffuse * light.ambient * lambert;
-      vec3 specular = material.specular * light.ambient * phong;
-      vec3 ambient = material.ambient * light.ambient;
-      //accumulated_light += (diffuse + specular + emissive) * attenuation;
-      //accumulated_light = tex_material.albedo_tint;
-      //taking attenuation factor into consideration
-      accumulated_light += (diffuse + specular) * attenuation + ambient;
-   }
+   //the directional lights reach every fragment
+   for(int index = 0; index < directional_light_count; index++)
+      accumulated_light += computeLight(readLight(index), material, normal, view);
+   //the point and spot lights are only the ones that reach the cluster of this fragment
+   uvec2 cluster = readCluster(fsin.world);
+   for(uint index = 0u; index < cluster.y; index++)
+      accumulated_light += computeLight(readLight(int(texelFetch(cluster_light_indices, int(cluster.x + index)).r)), material, normal, view);
+   //the ambient colors of all the lights are summed by the renderer so they are added once
+   accumulated_light += material.ambient * ambient_light;
    //final light of the pixel
    frag_color = fsin.color * vec4(accumulated_light, 1.0) * texture(tex, fsin.tex_coord);//taking the texture into consideration
    //frag_color = vec4(accumulated_light, 1.0f);
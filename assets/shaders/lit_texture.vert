@@ -19,18 +19,33 @@ out Varyings {
     vec3 normal;
 } vs_out;
 
-uniform mat4 transform;
+//the per-frame constants are uploaded once per frame by the renderer into a uniform buffer (std140 layout)
+layout(std140) uniform FrameConstants {
+    mat4 view;
+    mat4 projection;
+    mat4 VP;
+    vec3 cameraPosition;
+    float time;
+    vec3 ambient_light;
+    int directional_light_count;
+    ivec3 cluster_count;
+    float cluster_depth_scale;
+    vec2 cluster_tile_size;
+    float cluster_depth_bias;
+};
+
 //to transform the surface normal
 uniform mat4 objectToInvTranspose;
 //to pass the data of the vertex relative to the world space
 uniform mat4 objectToWorld;
-//used to calculate the specular
-uniform vec3 cameraPosition;
+
+// The depth pre-pass of the renderer (see "depth.vert") must compute exactly the same positions
+invariant gl_Position;
 
 void main(){
-    gl_Position = transform * vec4(position, 1.0); // apply transformation mat to the vec
     //calculate the position relative to the world space
     vs_out.world = (objectToWorld * vec4(position, 1.0f)).xyz;
+    gl_Position = VP * vec4(vs_out.world, 1.0); // apply the camera view projection to the world position
     vs_out.tex_coord = tex_coord;
     //calculate the view vector relative to the world space to be passed to the fragment shader to calculate the phong factor
     vs_out.view = cameraPosition - vs_out.world;
@@ -0,0 +1,45 @@
+#version 330 core
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec4 color;
+layout(location = 3) in vec3 normal;
+// the object to world matrix of each instance (a mat4 attribute takes the locations 4 to 7)
+layout(location = 4) in mat4 objectToWorld;
+
+out Varyings {
+    vec4 color;
+    vec3 world;
+    vec3 view;
+    vec3 normal;
+} vs_out;
+
+//the per-frame constants are uploaded once per frame by the renderer into a uniform buffer (std140 layout)
+layout(std140) uniform FrameConstants {
+    mat4 view;
+    mat4 projection;
+    mat4 VP;
+    vec3 cameraPosition;
+    float time;
+    vec3 ambient_light;
+    int directional_light_count;
+    ivec3 cluster_count;
+    float cluster_depth_scale;
+    vec2 cluster_tile_size;
+    float cluster_depth_bias;
+};
+
+// The depth pre-pass of the renderer (see "depth.vert") must compute exactly the same positions
+invariant gl_Position;
+
+// This is the same as "lit_tinted.vert" but it is used for instanced draws.
+// Since there is no per-object uniform, the normal matrix is computed from the per-instance matrix
+void main(){
+    //calculate the position relative to the world space
+    vs_out.world = (objectToWorld * vec4(position, 1.0f)).xyz;
+    //calculate the view vector relative to the world space to be passed to the fragment shader to calculate the phong factor
+    vs_out.view = cameraPosition - vs_out.world;
+    gl_Position = VP * vec4(vs_out.world, 1.0); // apply the camera view projection to the world position
+    vs_out.color = color;
+    //calculate the normal
+    vs_out.normal = normalize(transpose(inverse(mat3(objectToWorld))) * normal);
+}
@@ -0,0 +1,21 @@
+#version 330
+
+// This shader composites the weighted blended order independent transparency targets over the opaque scene.
+// While the transparent objects are drawn, the color (rgb) of the accumulation target and the weight target are summed,
+// while the alpha of the accumulation target is multiplied by (1 - alpha) of each surface (the revealage).
+// The output is blended with (1 - alpha, alpha) so the average color covers the scene by (1 - revealage).
+uniform sampler2D accumulation;
+uniform sampler2D weights;
+
+// Read "assets/shaders/fullscreen.vert" to know what "tex_coord" holds;
+in vec2 tex_coord;
+out vec4 frag_color;
+
+void main(){
+    vec4 accumulated = texture(accumulation, tex_coord);
+    float revealage = accumulated.a;
+    // Nothing transparent covers this pixel
+    if(revealage >= 1.0) discard;
+    vec3 average = accumulated.rgb / clamp(texture(weights, tex_coord).r, 1e-4, 5e4);
+    frag_color = vec4(average, revealage);
+}
@@ -9,10 +9,14 @@ out vec4 frag_color;
 
 uniform vec4 tint;
 uniform sampler2D tex;
+uniform float alphaThreshold;
 
 void main(){
     //TODO: (Req 7) Modify the following line to compute the fragment color
     // by multiplying the tint with the vertex color and with the texture color 
     //frag_color = vec4(1.0);
     frag_color = tint * fs_in.color * texture(tex, fs_in.tex_coord);
+    // The pixels whose alpha is below the threshold of the material are cut out
+    // (these materials are not drawn by the depth pre-pass, see "ForwardRenderer::usesDepthPrepass")
+    if(frag_color.a < alphaThreshold) discard;
 }
\ No newline at end of file
@@ -0,0 +1,37 @@
+#version 330 core
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec4 color;
+layout(location = 2) in vec2 tex_coord;
+// the object to world matrix of each instance (a mat4 attribute takes the locations 4 to 7)
+layout(location = 4) in mat4 objectToWorld;
+
+out Varyings {
+    vec4 color;
+    vec2 tex_coord;
+} vs_out;
+
+//the per-frame constants are uploaded once per frame by the renderer into a uniform buffer (std140 layout)
+layout(std140) uniform FrameConstants {
+    mat4 view;
+    mat4 projection;
+    mat4 VP;
+    vec3 cameraPosition;
+    float time;
+    vec3 ambient_light;
+    int directional_light_count;
+    ivec3 cluster_count;
+    float cluster_depth_scale;
+    vec2 cluster_tile_size;
+    float cluster_depth_bias;
+};
+
+// The depth pre-pass of the renderer (see "depth.vert") must compute exactly the same positions
+invariant gl_Position;
+
+// This is the same as "textured.vert" but it is used for instanced draws so the transform is built from the per-instance matrix
+void main(){
+    gl_Position = VP * vec4((objectToWorld * vec4(position, 1.0f)).xyz, 1.0);
+    vs_out.color = color;
+    vs_out.tex_coord = tex_coord;
+}
@@ -0,0 +1,26 @@
+#version 330 core
+
+// The order independent transparency variant of "textured.frag" (see "oit_composite.frag")
+in Varyings {
+    vec4 color;
+    vec2 tex_coord;
+} fs_in;
+
+// The sum of the weighted premultiplied colors (rgb) and the revealage (a)
+layout(location = 0) out vec4 accumulation;
+// The sum of the weighted alphas
+layout(location = 1) out float weight_sum;
+
+uniform vec4 tint;
+uniform sampler2D tex;
+uniform float alphaThreshold;
+
+void main(){
+    vec4 color = tint * fs_in.color * texture(tex, fs_in.tex_coord);
+    // The cut-out texels must not add any weight to the accumulation (the same as in "textured.frag")
+    if(color.a < alphaThreshold) discard;
+    // The weight decreases with the depth so that the closer surfaces dominate the average color (McGuire & Bavoil 2013)
+    float weight = clamp(pow(min(1.0, color.a * 10.0) + 0.01, 3.0) * 1e8 * pow(1.0 - gl_FragCoord.z * 0.9, 3.0), 1e-2, 3e3);
+    accumulation = vec4(color.rgb * color.a * weight, color.a);
+    weight_sum = color.a * weight;
+}
@@ -23,6 +23,9 @@
 #endif
 
 #include "texture/screenshot.hpp"
+#include "asset-loader.hpp"
+#include "texture/texture-uploader.hpp"
+#include "gl-state-cache.hpp"
 
 std::string default_screenshot_filepath() {
     std::stringstream stream;
@@ -196,6 +199,9 @@ int our::Application::run(int run_for_frames) {
     glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
 #endif
 
+    // The textures are uploaded through pixel unpack buffers. "textureUploadBudget" limits the bytes of the streamed textures per frame
+    our::TextureUploader::initialize(app_config.value("textureUploadBudget", size_t(0)));
+
     setupCallbacks();
     keyboard.enable(window);
     mouse.enable(window);
@@ -271,6 +277,10 @@ int our::Application::run(int run_for_frames) {
         // Get the current time (the time at which we are starting the current frame).
         double current_frame_time = glfwGetTime();
 
+        // Upload the streamed assets that finished loading since the last frame (their placeholders are replaced before drawing)
+        our::TextureUploader::beginFrame();
+        our::uploadStreamedAssets();
+
         // Call onDraw, in which we will draw the current frame, and send to it the time difference between the last and current frame
         if(currentState) currentState->onDraw(current_frame_time - last_frame_time);
         last_frame_time = current_frame_time; // Then update the last frame start time (this frame is now the last frame)
@@ -323,6 +333,8 @@ int our::Application::run(int run_for_frames) {
             // Switch scenes
             currentState = nextState;
             nextState = nullptr;
+            // The previous scene could have changed the OpenGL state directly, so we don't trust the cached state anymore
+            our::GLStateCache::invalidate();
             // Initialize the new scene
             currentState->onInitialize();
         }
@@ -332,6 +344,7 @@ int our::Application::run(int run_for_frames) {
 
     // Call for cleaning up
     if(currentState) currentState->onDestroy();
+    our::TextureUploader::destroy();
 
     // Shutdown ImGui & destroy the context
     ImGui_ImplOpenGL3_Shutdown();
@@ -12,6 +12,7 @@
 
 #include "input/keyboard.hpp"
 #include "input/mouse.hpp"
+#include "thread-pool.hpp"
 
 namespace our {
 
@@ -59,6 +60,8 @@ namespace our {
 
         nlohmann::json app_config;           // A Json file that contains all application configuration
 
+        ThreadPool threadPool;              // The worker threads shared by all the states (the size comes from "threads" in the config)
+
         std::unordered_map<std::string, State*> states;   // This will store all the states that the application can run
         State * currentState = nullptr;         // This will store the current scene that is being run
         State * nextState = nullptr;            // If it is requested to go to another scene, this will contain a pointer to that scene
@@ -73,7 +76,8 @@ namespace our {
     public:
 
         // Create an application with following configuration
-        Application(const nlohmann::json& app_config) : app_config(app_config) {}
+        // If the config has no "threads" (or it is 0), the thread pool uses all the hardware threads
+        Application(const nlohmann::json& app_config) : app_config(app_config), threadPool(app_config.value("threads", 0u)) {}
         // On destruction, delete all the states
         ~Application(){ for (auto &it : states) delete it.second; }
 
@@ -119,6 +123,8 @@ namespace our {
 
         [[nodiscard]] const nlohmann::json& getConfig() const { return app_config; }
 
+        ThreadPool& getThreadPool() { return threadPool; }
+
         // Get the size of the frame buffer of the window in pixels.
         glm::ivec2 getFrameBufferSize() {
             glm::ivec2 size;
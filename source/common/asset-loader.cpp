@@ -3,11 +3,18 @@
 #include "shader/shader.hpp"
 #include "texture/texture2d.hpp"
 #include "texture/texture-utils.hpp"
+#include "texture/texture-uploader.hpp"
 #include "texture/sampler.hpp"
 #include "mesh/mesh.hpp"
 #include "mesh/mesh-utils.hpp"
 #include "material/material.hpp"
 #include "deserialize-utils.hpp"
+#include "thread-pool.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
 
 namespace our {
 
@@ -24,7 +31,7 @@ namespace our {
                 shader->attach(vsPath, GL_VERTEX_SHADER);
                 shader->attach(fsPath, GL_FRAGMENT_SHADER);
                 shader->link();
-                assets[name] = shader;
+                add(name, shader);
             }
         }
     };
@@ -37,7 +44,7 @@ namespace our {
         if(data.is_object()){
             for(auto& [name, desc] : data.items()){
                 std::string path = desc.get<std::string>();
-                assets[name] = texture_utils::loadImage(path);
+                add(name, texture_utils::loadImage(path));
             }
         }
     };
@@ -55,7 +62,7 @@ namespace our {
             for(auto& [name, desc] : data.items()){
                 auto sampler = new Sampler();
                 sampler->deserialize(desc);
-                assets[name] = sampler;
+                add(name, sampler);
             }
         }
     };
@@ -68,7 +75,7 @@ namespace our {
         if(data.is_object()){
             for(auto& [name, desc] : data.items()){
                 std::string path = desc.get<std::string>();
-                assets[name] = mesh_utils::loadOBJ(path);
+                add(name, mesh_utils::loadOBJ(path));
             }
         }
     };
@@ -92,26 +99,210 @@ namespace our {
                 std::string type = desc.value("type", "");
                 auto material = createMaterialFromType(type);
                 material->deserialize(desc);
-                assets[name] = material;
+                add(name, material);
             }
         }
     };
 
-    void deserializeAllAssets(const nlohmann::json& assetData){
+    // A texture or a mesh whose file is read on the thread pool. Its job writes into it,
+    // so the pending assets are allocated separately to keep their addresses stable
+    struct PendingTexture {
+        std::string name, path;
+        texture_utils::Image image;
+        bool decoded = false;
+        std::atomic<bool> done{false};
+    };
+    struct PendingMesh {
+        std::string name, path;
+        mesh_utils::OBJData objData;
+        bool read = false;
+        std::atomic<bool> done{false};
+    };
+    struct PendingAssets {
+        std::vector<std::unique_ptr<PendingTexture>> textures;
+        std::vector<std::unique_ptr<PendingMesh>> meshes;
+    };
+
+    // The streamed assets wait here until "uploadStreamedAssets" uploads them
+    static struct {
+        ThreadPool* threadPool = nullptr;
+        JobGroup group;
+        PendingAssets pending;
+        std::chrono::steady_clock::time_point start;
+    } streaming;
+
+    static AssetLoadingStatistics loadingStatistics;
+
+    // Collects the textures and the meshes of "assetData" and starts reading their files on the thread pool.
+    // Background jobs are used for streaming so that they don't delay the frames that wait for other jobs
+    static void startReadingAssets(const nlohmann::json& assetData, ThreadPool& threadPool, JobGroup& group, PendingAssets& pending, bool background){
+        if(assetData.contains("textures") && assetData["textures"].is_object()){
+            for(auto& [name, desc] : assetData["textures"].items()){
+                auto texture = std::make_unique<PendingTexture>();
+                texture->name = name;
+                texture->path = desc.get<std::string>();
+                pending.textures.push_back(std::move(texture));
+            }
+        }
+        if(assetData.contains("meshes") && assetData["meshes"].is_object()){
+            for(auto& [name, desc] : assetData["meshes"].items()){
+                auto mesh = std::make_unique<PendingMesh>();
+                mesh->name = name;
+                mesh->path = desc.get<std::string>();
+                pending.meshes.push_back(std::move(mesh));
+            }
+        }
+        auto submit = [&](std::function<void()> job){
+            if(background) threadPool.submitBackground(std::move(job), &group);
+            else threadPool.submit(std::move(job), &group);
+        };
+        for(auto& texture : pending.textures){
+            PendingTexture* asset = texture.get();
+            submit([asset](){
+                asset->decoded = texture_utils::decodeImage(asset->path, asset->image);
+                asset->done.store(true, std::memory_order_release);
+            });
+        }
+        for(auto& mesh : pending.meshes){
+            PendingMesh* asset = mesh.get();
+            submit([asset](){
+                asset->read = mesh_utils::readOBJ(asset->path, asset->objData);
+                asset->done.store(true, std::memory_order_release);
+            });
+        }
+    }
+
+    // Uploads a pending asset whose file was read and puts it in its slot (a failed load is stored as a null asset like before)
+    static void uploadAsset(PendingTexture& texture){
+        AssetLoader<Texture2D>::add(texture.name, texture.decoded ? texture_utils::createTexture(texture.image) : nullptr);
+    }
+    static void uploadAsset(PendingMesh& mesh){
+        AssetLoader<Mesh>::add(mesh.name, mesh.read ? mesh_utils::createMesh(mesh.objData) : nullptr);
+    }
+
+    // Creates the assets that fill the slots of the streamed textures and meshes until they are loaded
+    static void createPlaceholders(){
+        if(!AssetLoader<Texture2D>::getPlaceholder()){
+            // A 1x1 white texture, so the tints of the materials still show
+            const unsigned char white[4] = {255, 255, 255, 255};
+            auto texture = new Texture2D();
+            texture->bind();
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+            Texture2D::unbind();
+            AssetLoader<Texture2D>::setPlaceholder(texture);
+        }
+        if(!AssetLoader<Mesh>::getPlaceholder())
+            AssetLoader<Mesh>::setPlaceholder(mesh_utils::cube());
+    }
+
+    void deserializeAllAssets(const nlohmann::json& assetData, ThreadPool* threadPool, bool stream){
         if(!assetData.is_object()) return;
-        if(assetData.contains("shaders"))
-            AssetLoader<ShaderProgram>::deserialize(assetData["shaders"]);
-        if(assetData.contains("textures"))
-            AssetLoader<Texture2D>::deserialize(assetData["textures"]);
-        if(assetData.contains("samplers"))
-            AssetLoader<Sampler>::deserialize(assetData["samplers"]);
-        if(assetData.contains("meshes"))
-            AssetLoader<Mesh>::deserialize(assetData["meshes"]);
-        if(assetData.contains("materials"))
-            AssetLoader<Material>::deserialize(assetData["materials"]);
+        auto start = std::chrono::steady_clock::now();
+        if(threadPool && stream){
+            // The textures and the meshes are put in their slots as placeholders so that the materials and the components
+            // can get handles to them right away. The real assets replace the placeholders in "uploadStreamedAssets"
+            createPlaceholders();
+            PendingAssets pending;
+            startReadingAssets(assetData, *threadPool, streaming.group, pending, true);
+            if(!streaming.threadPool) streaming.start = start;
+            streaming.threadPool = threadPool;
+            for(auto& texture : pending.textures){
+                AssetLoader<Texture2D>::add(texture->name, AssetLoader<Texture2D>::getPlaceholder());
+                streaming.pending.textures.push_back(std::move(texture));
+            }
+            for(auto& mesh : pending.meshes){
+                AssetLoader<Mesh>::add(mesh->name, AssetLoader<Mesh>::getPlaceholder());
+                streaming.pending.meshes.push_back(std::move(mesh));
+            }
+            if(assetData.contains("shaders"))
+                AssetLoader<ShaderProgram>::deserialize(assetData["shaders"]);
+            if(assetData.contains("samplers"))
+                AssetLoader<Sampler>::deserialize(assetData["samplers"]);
+            if(assetData.contains("materials"))
+                AssetLoader<Material>::deserialize(assetData["materials"]);
+        } else if(threadPool){
+            // The files are read and decoded on the thread pool
+            JobGroup group;
+            PendingAssets pending;
+            startReadingAssets(assetData, *threadPool, group, pending, false);
+
+            // Shaders and samplers need OpenGL, so they are created here while the workers decode the files
+            if(assetData.contains("shaders"))
+                AssetLoader<ShaderProgram>::deserialize(assetData["shaders"]);
+            if(assetData.contains("samplers"))
+                AssetLoader<Sampler>::deserialize(assetData["samplers"]);
+
+            // This thread helps with the remaining jobs, then uploads the results
+            threadPool->wait(group);
+            for(auto& texture : pending.textures) uploadAsset(*texture);
+            for(auto& mesh : pending.meshes) uploadAsset(*mesh);
+
+            // The materials are loaded last since they refer to the other assets
+            if(assetData.contains("materials"))
+                AssetLoader<Material>::deserialize(assetData["materials"]);
+        } else {
+            if(assetData.contains("shaders"))
+                AssetLoader<ShaderProgram>::deserialize(assetData["shaders"]);
+            if(assetData.contains("textures"))
+                AssetLoader<Texture2D>::deserialize(assetData["textures"]);
+            if(assetData.contains("samplers"))
+                AssetLoader<Sampler>::deserialize(assetData["samplers"]);
+            if(assetData.contains("meshes"))
+                AssetLoader<Mesh>::deserialize(assetData["meshes"]);
+            if(assetData.contains("materials"))
+                AssetLoader<Material>::deserialize(assetData["materials"]);
+        }
+        auto end = std::chrono::steady_clock::now();
+        loadingStatistics.loadTime = std::chrono::duration<double, std::milli>(end - start).count();
+        loadingStatistics.streamTime = 0.0;
+        loadingStatistics.threaded = threadPool != nullptr;
+        loadingStatistics.streamed = threadPool != nullptr && stream;
+    }
+
+    void uploadStreamedAssets(){
+        if(!streaming.threadPool) return;
+        // A pool without workers never runs the background jobs on its own, so we run one per frame
+        if(streaming.threadPool->getThreadCount() == 1) streaming.threadPool->runBackgroundJob();
+
+        // The finished assets are uploaded and removed in the same pass since more jobs can finish meanwhile.
+        // The textures stop once the upload budget of the frame is used (see "TextureUploader") and the rest wait for the next frames
+        auto uploadDone = [](auto& assets, auto&& canUpload){
+            for(size_t index = 0; index < assets.size() && canUpload();){
+                if(assets[index]->done.load(std::memory_order_acquire)){
+                    uploadAsset(*assets[index]);
+                    assets[index] = std::move(assets.back());
+                    assets.pop_back();
+                } else {
+                    index++;
+                }
+            }
+        };
+        uploadDone(streaming.pending.textures, [](){ return TextureUploader::hasBudget(); });
+        uploadDone(streaming.pending.meshes, [](){ return true; });
+
+        if(streaming.pending.textures.empty() && streaming.pending.meshes.empty()){
+            auto end = std::chrono::steady_clock::now();
+            loadingStatistics.streamTime = std::chrono::duration<double, std::milli>(end - streaming.start).count();
+            streaming.threadPool = nullptr;
+        }
+    }
+
+    bool isStreamingAssets(){
+        return streaming.threadPool != nullptr;
+    }
+
+    const AssetLoadingStatistics& getAssetLoadingStatistics(){
+        return loadingStatistics;
     }
 
     void clearAllAssets(){
+        if(streaming.threadPool){
+            // The jobs write into the pending assets, so we wait for them before dropping the assets that are still loading
+            streaming.threadPool->waitBackground(streaming.group);
+            streaming.pending.textures.clear();
+            streaming.pending.meshes.clear();
+            streaming.threadPool = nullptr;
+        }
         AssetLoader<ShaderProgram>::clear();
         AssetLoader<Texture2D>::clear();
         AssetLoader<Sampler>::clear();
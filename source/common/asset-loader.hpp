@@ -6,6 +6,27 @@
 
 namespace our {
 
+    class ThreadPool;
+
+    // A reference to an asset slot of the AssetLoader that always gives the current asset of the slot.
+    // While an asset is streamed (see "deserializeAllAssets"), its slot holds a placeholder (e.g. a white texture or a cube)
+    // and the slot is switched to the real asset once it is uploaded, so the objects holding handles pick it up on their own.
+    // A handle can also wrap a plain pointer (for the assets that are not owned by the AssetLoader).
+    // It converts to "T*" so it can be used like a pointer.
+    template<typename T>
+    class AssetHandle {
+        T* const* slot = nullptr;
+        T* asset = nullptr;
+    public:
+        AssetHandle() = default;
+        AssetHandle(T* asset) : asset(asset) {}
+        explicit AssetHandle(T* const* slot) : slot(slot) {}
+
+        T* get() const { return slot ? *slot : asset; }
+        T* operator->() const { return get(); }
+        operator T*() const { return get(); }
+    };
+
     // This static template class will hold the loaded assets
     // and can be called from anywhere to get an asset by its name.
     // Since we have different types of assets, this declared as a template class
@@ -14,7 +35,10 @@ namespace our {
     class AssetLoader {
         // This map stores a pointer to each asset identified by its name
         // All assets in this map are owned by the asset loader so it should not be deleted outside of this class
+        // The slots of the map are never moved (the map is node based), so handles can point to them until "clear" is called
         static inline std::unordered_map<std::string, T*> assets;
+        // The asset given to the objects while the real asset is still loading (see "AssetHandle"). It is null for the types that are not streamed
+        static inline T* placeholder = nullptr;
     public:
         // This function loads the assets defined by the given json object
         // The json object should be defined in the form: {asset_name: asset_description}
@@ -32,20 +56,64 @@ namespace our {
             }
             return nullptr;
         };
+        // This function returns a handle to the slot of an asset. Unlike the pointer returned by "get",
+        // the handle follows the slot when a streamed asset replaces its placeholder
+        // If no asset with the given name was found, the handle is null
+        static AssetHandle<T> getAsync(const std::string& name) {
+            if(auto it = assets.find(name); it != assets.end()){
+                return AssetHandle<T>(&it->second);
+            }
+            return AssetHandle<T>();
+        }
+        // This function adds an asset under the given name. The asset loader takes the ownership of the asset
+        // If the name already exists, the slot is reused so the handles to it get the new asset and the old asset is deleted
+        // (unless it is the placeholder, which is owned separately)
+        static void add(const std::string& name, T* asset) {
+            T*& slot = assets[name];
+            if(slot != asset && slot != placeholder) delete slot;
+            slot = asset;
+        }
+        // These functions set and get the placeholder (the asset loader takes the ownership of the placeholder)
+        static void setPlaceholder(T* asset) {
+            delete placeholder;
+            placeholder = asset;
+        }
+        static T* getPlaceholder() { return placeholder; }
         // This function deletes all the assets held by this class and clear the assets map 
         static void clear(){
             for(auto& [name, asset] : assets){
-                delete asset;
+                if(asset != placeholder) delete asset;
             }
             assets.clear();
+            setPlaceholder(nullptr);
         }
     };
 
+    // The time taken by the last call of "deserializeAllAssets" (in milliseconds) and, if it streamed the textures and the meshes,
+    // the time from that call until the last streamed asset was uploaded (0 while they are still streaming)
+    struct AssetLoadingStatistics {
+        double loadTime = 0.0;
+        double streamTime = 0.0;
+        bool threaded = false;  // Whether the files were read on the thread pool
+        bool streamed = false;  // Whether the textures and the meshes were streamed
+    };
+
     // Given a json holding the data for all the assets
     // This function will call "AssetLoader<T>::deserialize" for all the different asset types T
     // For example, a json in the form {"shaders": ... , "textures": ... } will call "deserialize" for:
     // AssetLoader<ShaderProgram> and AssetLoader<Texture2D>
-    void deserializeAllAssets(const nlohmann::json& assetData);
+    // If a thread pool is given, the texture and mesh files are read and decoded on the pool while this thread compiles the shaders,
+    // then this thread uploads them (OpenGL is only called on this thread). The materials are still loaded last since they refer to the other assets
+    // If "stream" is also true, this function returns without waiting for the textures and the meshes: their slots hold placeholders
+    // until "uploadStreamedAssets" uploads them, so the first frames can be drawn while the files are still loading
+    void deserializeAllAssets(const nlohmann::json& assetData, ThreadPool* threadPool = nullptr, bool stream = false);
+    // Uploads the streamed assets whose files are loaded and puts them in their slots. It is called once per frame by the application
+    void uploadStreamedAssets();
+    // Returns true if some streamed assets are not uploaded yet
+    bool isStreamingAssets();
+    // Returns the timings of the last asset loading (see "AssetLoadingStatistics")
+    const AssetLoadingStatistics& getAssetLoadingStatistics();
     // This will call "AssetLoader<T>::clear" for all the different asset types T
+    // (it first waits for the streamed assets that are still loading and drops them)
     void clearAllAssets();
 }
\ No newline at end of file
@@ -11,7 +11,8 @@ namespace our {
         // Hint: To get a value of type T from a json object "data" where the key corresponding to the value is "key",
         // you can use write: data["key"].get<T>().
         // Look at "source/common/asset-loader.hpp" to know how to use the static class AssetLoader.
-        mesh = AssetLoader<Mesh>::get(data["mesh"].get<std::string>());
+        // The mesh is taken as a handle so that the component picks up a streamed mesh once it is loaded
+        mesh = AssetLoader<Mesh>::getAsync(data["mesh"].get<std::string>());
         material = AssetLoader<Material>::get(data["material"].get<std::string>());
     }
 }
\ No newline at end of file
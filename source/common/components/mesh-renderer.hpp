@@ -10,7 +10,7 @@ namespace our {
     // This component denotes that any renderer should draw the given mesh using the given material at the transformation of the owning entity.
     class MeshRendererComponent : public Component {
     public:
-        Mesh* mesh; // The mesh that should be drawn
+        AssetHandle<Mesh> mesh; // The mesh that should be drawn (it can be a placeholder while the mesh is streamed)
         Material* material; // The material used to draw the mesh
 
         // The ID of this component type is "Mesh Renderer"
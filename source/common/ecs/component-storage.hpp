@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace our {
+
+    class Entity; // A forward declaration of the Entity Class
+    class Component; // A forward declaration of the Component Class
+
+    // A sparse set that stores the components of a single type held by the entities of a world.
+    // The components (and their owners) are packed in dense arrays so that a system can iterate over them without
+    // visiting the entities that don't have this component type. The sparse array maps an entity index to its dense index.
+    // Adding, removing and finding a component are O(1). Removing a component moves the last one into its place.
+    class ComponentStorage {
+        static constexpr std::uint32_t INVALID_INDEX = 0xFFFFFFFF;
+
+        std::vector<std::uint32_t> sparse; // The dense index of each entity index (or INVALID_INDEX if the entity has no component here)
+        std::vector<Entity*> entities; // The owner of each component in "components"
+        std::vector<std::uint32_t> entityIndices; // The index of the owner of each component in "components"
+        std::vector<Component*> components;
+    public:
+        // Adds the component of the given entity. If the entity already has a component in this storage, it is replaced
+        void add(std::uint32_t entityIndex, Entity* entity, Component* component) {
+            if(entityIndex >= sparse.size()) sparse.resize(entityIndex + 1, INVALID_INDEX);
+            if(sparse[entityIndex] != INVALID_INDEX){
+                components[sparse[entityIndex]] = component;
+                return;
+            }
+            sparse[entityIndex] = (std::uint32_t)entities.size();
+            entities.push_back(entity);
+            entityIndices.push_back(entityIndex);
+            components.push_back(component);
+        }
+
+        // Removes the component of the given entity (if it exists)
+        void remove(std::uint32_t entityIndex) {
+            if(entityIndex >= sparse.size() || sparse[entityIndex] == INVALID_INDEX) return;
+            std::uint32_t denseIndex = sparse[entityIndex];
+            std::uint32_t lastIndex = (std::uint32_t)entities.size() - 1;
+            if(denseIndex != lastIndex){
+                // Move the last element into the hole and update its sparse entry
+                entities[denseIndex] = entities[lastIndex];
+                entityIndices[denseIndex] = entityIndices[lastIndex];
+                components[denseIndex] = components[lastIndex];
+                sparse[entityIndices[denseIndex]] = denseIndex;
+            }
+            entities.pop_back();
+            entityIndices.pop_back();
+            components.pop_back();
+            sparse[entityIndex] = INVALID_INDEX;
+        }
+
+        // Returns the component of the given entity or nullptr if it has none in this storage
+        Component* get(std::uint32_t entityIndex) const {
+            if(entityIndex >= sparse.size() || sparse[entityIndex] == INVALID_INDEX) return nullptr;
+            return components[sparse[entityIndex]];
+        }
+
+        size_t size() const { return entities.size(); }
+        const std::vector<Entity*>& getEntities() const { return entities; }
+        const std::vector<std::uint32_t>& getEntityIndices() const { return entityIndices; }
+        const std::vector<Component*>& getComponents() const { return components; }
+
+        void clear() {
+            sparse.clear();
+            entities.clear();
+            entityIndices.clear();
+            components.clear();
+        }
+    };
+
+}
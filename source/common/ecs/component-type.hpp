@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cassert>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace our {
+
+    // The maximum number of component types. Each type takes one bit in the component mask of the entity
+    #define MAX_COMPONENT_TYPES 64
+
+    typedef std::uint32_t ComponentTypeID;
+    // A bit mask where the bit "i" is set if the entity has a component whose type id is "i"
+    typedef std::uint64_t ComponentMask;
+
+    // This static class gives each component type a small unique id at compile time (the first time the id is requested)
+    // The ids are only used at runtime (they are not stable between runs), so they must not be saved to files
+    // A type may be seen for the first time by a system running on a worker thread, so the counter is atomic
+    // (and the local static below is initialized once even if two threads request the same type at once)
+    class ComponentTypes {
+        static inline std::atomic<ComponentTypeID> nextID{0};
+    public:
+        template<typename T>
+        static ComponentTypeID get() {
+            static const ComponentTypeID id = nextID.fetch_add(1, std::memory_order_relaxed);
+            assert(id < MAX_COMPONENT_TYPES && "Too many component types. Increase MAX_COMPONENT_TYPES");
+            return id;
+        }
+
+        // Returns the mask that only contains the given component type
+        template<typename T>
+        static ComponentMask mask() {
+            return ComponentMask(1) << get<T>();
+        }
+    };
+
+    // Returns the number of bits set in the given mask
+    inline std::uint32_t countBits(ComponentMask mask) {
+    #if defined(_MSC_VER)
+        return (std::uint32_t)__popcnt64(mask);
+    #else
+        return (std::uint32_t)__builtin_popcountll(mask);
+    #endif
+    }
+
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+
+namespace our {
+
+    // The number of bits of the entity id used for the index. The remaining bits hold the generation.
+    // With 20 bits, a world has up to ~1M slots and each slot can be reused 4095 times (12 bits of generation).
+    // The generation of a slot never wraps around: when it reaches ENTITY_GENERATION_MASK, the slot is retired for the
+    // lifetime of the world (see "World::release"), so an old handle can never resolve to a newer entity.
+    #define ENTITY_INDEX_BITS 20
+    #define ENTITY_INDEX_MASK ((1u << ENTITY_INDEX_BITS) - 1)
+    #define ENTITY_GENERATION_MASK ((1u << (32 - ENTITY_INDEX_BITS)) - 1)
+
+    // A 32-bit handle that identifies an entity in a world. It contains the index of the entity's slot in the world
+    // and the generation of that slot when the entity was created. When an entity is deleted, the generation of its slot
+    // is incremented so the old handles stop resolving (see "World::get") even if the slot is reused by a new entity.
+    // Unlike an "Entity*", a handle can be kept across frames without the risk of accessing a deleted entity.
+    class EntityId {
+        std::uint32_t value;
+    public:
+        constexpr EntityId() : value(0xFFFFFFFF) {} // A null handle which never resolves to an entity
+        constexpr EntityId(std::uint32_t index, std::uint32_t generation)
+            : value((index & ENTITY_INDEX_MASK) | ((generation & ENTITY_GENERATION_MASK) << ENTITY_INDEX_BITS)) {}
+
+        std::uint32_t getIndex() const { return value & ENTITY_INDEX_MASK; }
+        std::uint32_t getGeneration() const { return value >> ENTITY_INDEX_BITS; }
+        bool isNull() const { return value == 0xFFFFFFFF; }
+        std::uint32_t getValue() const { return value; }
+
+        bool operator==(const EntityId& other) const { return value == other.value; }
+        bool operator!=(const EntityId& other) const { return value != other.value; }
+    };
+
+}
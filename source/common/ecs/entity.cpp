@@ -1,8 +1,10 @@
 #include "entity.hpp"
+#include "world.hpp"
 #include "../deserialize-utils.hpp"
 #include "../components/component-deserializer.hpp"
 
 #include <glm/gtx/euler_angles.hpp>
+#include <algorithm>
 
 namespace our {
 
@@ -10,15 +12,72 @@ namespace our {
     // Remember that you can get the transformation matrix from this entity to its parent from "localTransform"
     // To get the local to world matrix, you need to combine this entities matrix with its parent's matrix and
     // its parent's parent's matrix and so on till you reach the root.
-    glm::mat4 Entity::getLocalToWorldMatrix() const {
+    // Each ancestor only compares its transform with its cached copy, so the matrices are computed once per change
+    // instead of recomputing the whole chain on every call.
+    const glm::mat4& Entity::getLocalToWorldMatrix() const {
         //TODO: (Req 8) Write this function
-        glm::mat4 globalTransform = this->localTransform.toMat4();
         if (this->parent != nullptr)
-        {
+            this->parent->getLocalToWorldMatrix(); // make sure the parent's cache is up to date first
+        updateWorldMatrix();
+        return cachedWorldMatrix;
+    }
+
+    void Entity::updateWorldMatrix() const {
+        bool dirty = worldMatrixVersion == 0;
+        if (localTransform != cachedLocalTransform || dirty) {
+            cachedLocalTransform = localTransform;
+            cachedLocalMatrix = localTransform.toMat4();
+            dirty = true;
+        }
+        if (parent != cachedParent) {
+            cachedParent = parent;
+            dirty = true;
+        }
+        if (parent != nullptr && parent->worldMatrixVersion != cachedParentVersion) {
+            cachedParentVersion = parent->worldMatrixVersion;
+            dirty = true;
+        }
+        if (dirty) {
             /*if there is a parent, multiply this entity's local transform by it's parents transform*/
-            globalTransform = this->parent->getLocalToWorldMatrix() * globalTransform;
+            cachedWorldMatrix = parent != nullptr ? parent->cachedWorldMatrix * cachedLocalMatrix : cachedLocalMatrix;
+            worldMatrixVersion = nextWorldMatrixVersion.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void* Entity::allocateComponentMemory(ComponentTypeID id, size_t size, size_t alignment) {
+        return world->getComponentPool(id, size, alignment).allocate();
+    }
+
+    void Entity::destroyComponent(Component* component) {
+        // The pool gave us the address of the concrete object which may differ from the address of its Component base
+        void* memory = dynamic_cast<void*>(component);
+        BlockPool* pool = world->findComponentPool(component->getTypeID());
+        component->~Component();
+        pool->deallocate(memory);
+    }
+
+    void Entity::registerComponent(Component* component) {
+        world->getStorage(component->getTypeID()).add(getIndex(), this, component);
+    }
+
+    void Entity::removeComponent(std::list<Component*>::iterator it) {
+        Component* component = *it;
+        ComponentTypeID id = component->getTypeID();
+        components.erase(it);
+        size_t slot = getTypeSlot(id);
+        if ((componentMask & (ComponentMask(1) << id)) && componentsByType[slot] == component) {
+            // If the entity has another component of the same type, it takes the place of the deleted one in the index
+            auto other = std::find_if(components.begin(), components.end(), [id](Component* c) { return c->getTypeID() == id; });
+            if (other != components.end()) {
+                componentsByType[slot] = *other;
+                registerComponent(*other);
+            } else {
+                componentsByType.erase(componentsByType.begin() + slot);
+                componentMask &= ~(ComponentMask(1) << id);
+                world->getStorage(id).remove(getIndex());
+            }
         }
-        return globalTransform;
+        destroyComponent(component);
     }
 
     // Deserializes the entity data and components from a json object
@@ -2,9 +2,13 @@
 
 #include "component.hpp"
 #include "transform.hpp"
+#include "entity-id.hpp"
 #include <list>
 #include <iterator>
 #include <string>
+#include <cstdint>
+#include <atomic>
+#include <vector>
 #include <glm/glm.hpp>
 
 namespace our {
@@ -13,10 +17,46 @@ namespace our {
 
     class Entity{
         World *world; // This defines what world own this entity
+        EntityId id; // The handle of this entity in its world. Its index is also the key in the world's component storages
+        bool markedForRemoval = false; // Whether this entity is waiting to be deleted by "World::deleteMarkedEntities"
         std::list<Component*> components; // A list of components that are owned by this entity
+        ComponentMask componentMask = 0; // The bit "i" is set if the entity has a component whose type id is "i"
+        // The first component of each type held by this entity ordered by the type id.
+        // The component of a type with the id "i" is at the index "countBits(componentMask & ((1 << i) - 1))"
+        std::vector<Component*> componentsByType;
 
         friend World; // The world is a friend since it is the only class that is allowed to instantiate an entity
         Entity() = default; // The entity constructor is private since only the world is allowed to instantiate an entity
+
+        // The cached matrices. Since "localTransform" and "parent" can be modified directly, the cache keeps a copy of the values
+        // that were used to compute it and the matrices are recomputed only when the current values differ from the copies.
+        // Each time the world matrix is recomputed, it gets a new version so that the children know that they must be recomputed too.
+        // The version counter is atomic since the entities of a hierarchy level may be updated in parallel (see "World::updateTransforms").
+        mutable glm::mat4 cachedLocalMatrix = glm::mat4(1.0f), cachedWorldMatrix = glm::mat4(1.0f);
+        mutable Transform cachedLocalTransform;
+        mutable const Entity* cachedParent = nullptr;
+        mutable std::uint64_t worldMatrixVersion = 0; // 0 means that the world matrix was never computed
+        mutable std::uint64_t cachedParentVersion = 0;
+        static inline std::atomic<std::uint64_t> nextWorldMatrixVersion{1};
+
+        // Returns the index of the given component type in "componentsByType" (the number of types with a smaller id)
+        size_t getTypeSlot(ComponentTypeID id) const {
+            return countBits(componentMask & ((ComponentMask(1) << id) - 1));
+        }
+
+        // Returns memory for a component of the given type from the world's pools and gives it back when the component is destroyed
+        // (defined in "entity.cpp" where the World class is complete)
+        void* allocateComponentMemory(ComponentTypeID id, size_t size, size_t alignment);
+        void destroyComponent(Component* component);
+
+        // Adds the component to the storage of its type in the world (defined in "entity.cpp" where the World class is complete)
+        void registerComponent(Component* component);
+
+        // Deletes the given component and removes it from the components list and the type index
+        void removeComponent(std::list<Component*>::iterator it);
+
+        // Recomputes the cached world matrix if needed, assuming that the parent's cache is already up to date
+        void updateWorldMatrix() const;
     public:
         std::string name; // The name of the entity. It could be useful to refer to an entity by its name
         Entity* parent;   // The parent of the entity. The transform of the entity is relative to its parent.
@@ -24,8 +64,15 @@ namespace our {
         Transform localTransform; // The transform of this entity relative to its parent.
 
         World* getWorld() const { return world; } // Returns the world to which this entity belongs
-
-        glm::mat4 getLocalToWorldMatrix() const; // Computes and returns the transformation from the entities local space to the world space
+        EntityId getId() const { return id; } // Returns the handle of this entity (which can be resolved using "World::get")
+        std::uint32_t getIndex() const { return id.getIndex(); } // Returns the index of this entity in its world
+
+        // Returns the transformation from the entities local space to the world space
+        // The result is cached and it is only recomputed when the transform of this entity or one of its ancestors changes
+        const glm::mat4& getLocalToWorldMatrix() const;
+        // Returns the world matrix computed by the last call to "World::updateTransforms" without checking if it is stale.
+        // Unlike "getLocalToWorldMatrix", it never writes to the cache so it can be called from multiple threads
+        const glm::mat4& getCachedLocalToWorldMatrix() const { return cachedWorldMatrix; }
         void deserialize(const nlohmann::json&); // Deserializes the entity data and components from a json object
         
         // This template method create a component of type T,
@@ -35,30 +82,41 @@ namespace our {
             static_assert(std::is_base_of<Component, T>::value, "T must inherit from Component");
             //TODO: (Req 8) Create an component of type T, set its "owner" to be this entity, then push it into the component's list
             // Don't forget to return a pointer to the new component
-            T* newComponent = new T();
+            // The memory of the component comes from the pool of its type in the world (see "World::getComponentPool")
+            T* newComponent = new (allocateComponentMemory(ComponentTypes::get<T>(), sizeof(T), alignof(T))) T();
             newComponent->owner = this;
+            newComponent->typeID = ComponentTypes::get<T>();
             components.push_back(newComponent);
-            
+            // Only the first component of each type is indexed (which is the one returned by "getComponent")
+            if(!(componentMask & (ComponentMask(1) << newComponent->typeID))){
+                componentsByType.insert(componentsByType.begin() + getTypeSlot(newComponent->typeID), newComponent);
+                componentMask |= ComponentMask(1) << newComponent->typeID;
+                registerComponent(newComponent);
+            }
             return newComponent;
         }
 
         // This template method searhes for a component of type T and returns a pointer to it
         // If no component of type T was found, it returns a nullptr 
+        // NOTE: Only components whose type is exactly T are found (components of types derived from T are not returned)
         template<typename T>
         T* getComponent(){
             //TODO: (Req 8) Go through the components list and find the first component that can be dynamically cast to "T*".
             // Return the component you found, or return null of nothing was found.
-            
-            for(auto it = components.begin(); it != components.end(); ++it)
-            {
-                if (dynamic_cast<T*>(*it) != nullptr)
-                {
-                    return dynamic_cast<T*>(*it);
-                }
-            }
-            return nullptr;
+            // The mask tells us if there is a component of type T and the index of its slot, so no search is needed
+            ComponentTypeID id = ComponentTypes::get<T>();
+            if(!(componentMask & (ComponentMask(1) << id))) return nullptr;
+            return static_cast<T*>(componentsByType[getTypeSlot(id)]);
+        }
+
+        // Returns true if this entity has a component of each of the types in the given mask
+        bool hasComponents(ComponentMask mask) const {
+            return (componentMask & mask) == mask;
         }
 
+        // Returns the mask of the types of the components held by this entity
+        ComponentMask getComponentMask() const { return componentMask; }
+
         // This template method dynami and returns a pointer to it
         // If no component of type T was found, it returns a nullptr 
         template<typename T>
@@ -75,26 +133,16 @@ namespace our {
         void deleteComponent(){
             //TODO: (Req 8) Go through the components list and find the first component that can be dynamically cast to "T*".
             // If found, delete the found component and remove it from the components list
-
-            for(auto it = components.begin(); it != components.end(); ++it)
-            {
-                if (dynamic_cast<T*>(*it) != nullptr)
-                {
-                    delete *it;
-                    components.erase(it);
-                    break;
-                }
-            }
+            if(T* component = getComponent<T>(); component)
+                deleteComponent(component);
         }
 
         // This template method searhes for a component of type T and deletes it
         void deleteComponent(size_t index){
             auto it = components.begin();
             std::advance(it, index);
-            if(it != components.end()) {
-                delete *it;
-                components.erase(it);
-            }
+            if(it != components.end())
+                removeComponent(it);
         }
 
         // This template method searhes for the given component and deletes it
@@ -107,8 +155,7 @@ namespace our {
             {
                 if (*it == component)
                 {
-                    delete *it;
-                    components.erase(it);
+                    removeComponent(it);
                     break;
                 }
             }
@@ -120,10 +167,12 @@ namespace our {
            
             for(auto it = components.begin(); it != components.end(); ++it)
             {
-                delete *it;
+                destroyComponent(*it);
             }
 
             components.clear();
+            componentsByType.clear();
+            componentMask = 0;
         }
 
         // Entities should not be copyable
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+namespace our {
+
+    // A pool of fixed-size memory slots that are allocated from big blocks instead of calling "new" for every object.
+    // The blocks are never moved or freed until the pool is destroyed, so the address of an object stays valid while it is alive.
+    // Freed slots are kept in a free list (stored inside the free slots themselves) and are reused by the next allocations.
+    // NOTE: The pool only manages the memory, the objects must be constructed (placement new) and destroyed by the caller.
+    class BlockPool {
+        size_t slotSize;      // The size of each slot in bytes (a multiple of the alignment)
+        size_t alignment;     // The alignment of each slot
+        size_t slotsPerBlock; // The number of slots in each block
+        std::vector<void*> blocks; // All the blocks allocated by this pool
+        size_t usedBlocks = 0;     // The blocks before "usedBlocks" have been (partially) used since the last reset
+        size_t nextSlot = 0;       // The next unused slot in the last used block
+        void* freeList = nullptr;  // The first free slot (each free slot stores a pointer to the next one)
+
+    public:
+        BlockPool(size_t size, size_t alignment, size_t slotsPerBlock = 256) : slotsPerBlock(slotsPerBlock) {
+            // Each slot must be able to hold a pointer when it is in the free list
+            this->alignment = alignment < alignof(void*) ? alignof(void*) : alignment;
+            if(size < sizeof(void*)) size = sizeof(void*);
+            slotSize = (size + this->alignment - 1) / this->alignment * this->alignment;
+        }
+
+        ~BlockPool() {
+            for(void* block : blocks) ::operator delete(block, std::align_val_t(alignment));
+        }
+
+        // Returns the memory of a slot that can hold an object of the size given to the constructor
+        void* allocate() {
+            if(freeList){
+                void* slot = freeList;
+                freeList = *static_cast<void**>(slot);
+                return slot;
+            }
+            if(usedBlocks == 0 || nextSlot == slotsPerBlock){
+                // We reuse the blocks that were kept by "reset" before allocating new ones
+                if(usedBlocks == blocks.size())
+                    blocks.push_back(::operator new(slotSize * slotsPerBlock, std::align_val_t(alignment)));
+                usedBlocks++;
+                nextSlot = 0;
+            }
+            return static_cast<std::byte*>(blocks[usedBlocks - 1]) + slotSize * nextSlot++;
+        }
+
+        // Returns the slot to the pool so that it can be reused
+        void deallocate(void* slot) {
+            *static_cast<void**>(slot) = freeList;
+            freeList = slot;
+        }
+
+        // Makes all the slots free at once without returning the blocks to the system.
+        // All the objects in the pool must have been destroyed before calling this function
+        void reset() {
+            usedBlocks = 0;
+            nextSlot = 0;
+            freeList = nullptr;
+        }
+
+        // Returns the number of blocks allocated by the pool
+        size_t getBlockCount() const { return blocks.size(); }
+
+        BlockPool(const BlockPool&) = delete;
+        BlockPool& operator=(const BlockPool&) = delete;
+    };
+
+}
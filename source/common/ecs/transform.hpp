@@ -14,6 +14,11 @@ namespace our {
 
         // This function computes and returns a matrix that represents this transform
         glm::mat4 toMat4() const;
+        // Two transforms are equal if all their components are equal (used to detect changes in the cached world matrices)
+        bool operator==(const Transform& other) const {
+            return position == other.position && rotation == other.rotation && scale == other.scale;
+        }
+        bool operator!=(const Transform& other) const { return !(*this == other); }
          // Deserializes the entity data and components from a json object
         void deserialize(const nlohmann::json&);
     };
@@ -1,4 +1,5 @@
 #include "world.hpp"
+#include "../thread-pool.hpp"
 
 namespace our {
 
@@ -20,4 +21,28 @@ namespace our {
         }
     }
 
-}
\ No newline at end of file
+    // The minimum number of entities updated by a single job when a thread pool is used
+    #define MIN_TRANSFORMS_PER_JOB 512
+
+    void World::updateTransforms(ThreadPool* pool){
+        for(auto& level : transformLevels) level.clear();
+        for(auto entity : entities){
+            size_t depth = 0;
+            for(Entity* ancestor = entity->parent; ancestor != nullptr; ancestor = ancestor->parent) depth++;
+            if(depth >= transformLevels.size()) transformLevels.resize(depth + 1);
+            transformLevels[depth].push_back(entity);
+        }
+        for(auto& level : transformLevels){
+            // The entities of a level only read the matrices of the previous levels so they can be updated in any order
+            if(pool){
+                pool->parallelFor(level.size(), MIN_TRANSFORMS_PER_JOB, [&level](size_t begin, size_t end){
+                    for(size_t index = begin; index < end; index++) level[index]->updateWorldMatrix();
+                });
+            } else {
+                for(auto entity : level)
+                    entity->updateWorldMatrix();
+            }
+        }
+    }
+
+}
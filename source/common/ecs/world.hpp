@@ -1,15 +1,67 @@
 #pragma once
 
-#include <unordered_set>
+#include <vector>
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 #include "entity.hpp"
+#include "component-storage.hpp"
+#include "pool.hpp"
 
 namespace our {
 
+    template<typename... Ts> class Query; // A forward declaration of the Query Class (defined below)
+    class ThreadPool; // A forward declaration of the ThreadPool Class
+
     // This class holds a set of entities
     class World {
-        std::unordered_set<Entity*> entities; // These are the entities held by this world
-        std::unordered_set<Entity*> markedForRemoval; // These are the entities that are awaiting to be deleted
-                                                      // when deleteMarkedEntities is called
+        // Each entity index has a slot that stores the entity currently using this index (if any) and the generation of the slot.
+        // The generation is incremented every time the entity in the slot is deleted so the old handles become invalid.
+        struct EntitySlot {
+            Entity* entity = nullptr;
+            std::uint32_t generation = 0;
+            std::uint32_t denseIndex = 0; // The position of the entity in the "entities" vector
+        };
+
+        std::vector<Entity*> entities; // These are the entities held by this world (packed so that they can be iterated quickly)
+        std::vector<EntitySlot> slots; // The slot of each entity index
+        std::vector<std::uint32_t> freeIndices; // The indices of the deleted entities which can be given to new entities
+        std::vector<Entity*> markedForRemoval; // These are the entities that are awaiting to be deleted
+                                               // when deleteMarkedEntities is called
+        std::vector<std::vector<Entity*>> transformLevels; // The entities grouped by their depth in the hierarchy (used by "updateTransforms")
+        ComponentStorage storages[MAX_COMPONENT_TYPES]; // The components of each type (indexed by the component type id)
+        // The memory of the entities and the components comes from these pools (one pool per component type)
+        // so that spawning and deleting entities does not allocate from the heap once the pools have grown
+        BlockPool entityPool = BlockPool(sizeof(Entity), alignof(Entity));
+        std::unique_ptr<BlockPool> componentPools[MAX_COMPONENT_TYPES];
+
+        // Invalidates the old handles of the slot and makes its index available for new entities.
+        // A slot whose generation reaches ENTITY_GENERATION_MASK is retired (never reused) so its generation never wraps around
+        void release(std::uint32_t index){
+            EntitySlot& slot = slots[index];
+            slot.entity = nullptr;
+            if(++slot.generation < ENTITY_GENERATION_MASK) freeIndices.push_back(index);
+        }
+
+        // Removes the entity from the component storages and the entities vector, deletes it and frees its slot. This is O(1)
+        void destroy(Entity* entity){
+            std::uint32_t index = entity->getIndex();
+            for(ComponentMask mask = entity->getComponentMask(); mask != 0; mask &= mask - 1)
+                storages[countBits((mask & (~mask + 1)) - 1)].remove(index);
+            // Move the last entity into the hole left by this entity
+            EntitySlot& slot = slots[index];
+            Entity* last = entities.back();
+            entities[slot.denseIndex] = last;
+            slots[last->getIndex()].denseIndex = slot.denseIndex;
+            entities.pop_back();
+            release(index);
+            entity->~Entity();
+            entityPool.deallocate(entity);
+        }
     public:
 
         World() = default;
@@ -26,15 +78,60 @@ namespace our {
         Entity* add() {
             //TODO: (Req 8) Create a new entity, set its world member variable to this,
             // and don't forget to insert it in the suitable container.
-            Entity* newEntity = new Entity();
+            std::uint32_t index;
+            if(!freeIndices.empty()){
+                index = freeIndices.back();
+                freeIndices.pop_back();
+            } else {
+                index = (std::uint32_t)slots.size();
+                assert(index < ENTITY_INDEX_MASK && "Too many entities. Increase ENTITY_INDEX_BITS");
+                slots.emplace_back();
+            }
+            Entity* newEntity = new (entityPool.allocate()) Entity();
             newEntity->world = this;
-            entities.insert(newEntity);
+            newEntity->id = EntityId(index, slots[index].generation);
+            slots[index].entity = newEntity;
+            slots[index].denseIndex = (std::uint32_t)entities.size();
+            entities.push_back(newEntity);
 
             return newEntity;
         }
 
+        // Returns the entity identified by the given handle or nullptr if the entity was deleted (or the handle is null)
+        Entity* get(EntityId id) const {
+            if(id.isNull() || id.getIndex() >= slots.size()) return nullptr;
+            const EntitySlot& slot = slots[id.getIndex()];
+            return slot.generation == id.getGeneration() ? slot.entity : nullptr;
+        }
+
+        // This updates the cached local to world matrices of all the entities in the world.
+        // The entities are processed level by level (roots first) so every entity is computed once after its parent.
+        // It should be called once per frame after the entities are moved and before their matrices are used.
+        // If a thread pool is given, the entities of each level are updated in parallel.
+        void updateTransforms(ThreadPool* pool = nullptr);
+
+        // Returns the pool that holds the memory of the components of the given type id (it is created on the first call)
+        BlockPool& getComponentPool(ComponentTypeID id, size_t size, size_t alignment) {
+            if(!componentPools[id]) componentPools[id] = std::make_unique<BlockPool>(size, alignment);
+            return *componentPools[id];
+        }
+        // Returns the pool of the given type id or nullptr if no component of this type was created yet
+        BlockPool* findComponentPool(ComponentTypeID id) { return componentPools[id].get(); }
+
+        // Returns the storage that holds all the components of the given type id in this world
+        ComponentStorage& getStorage(ComponentTypeID id) { return storages[id]; }
+
+        // Returns a view over all the entities that have a component of each of the given types.
+        // The types can be component types, "Transform" (the entity's local transform) or "Entity" (the entity itself)
+        // and the view is iterated as tuples of pointers which can be unpacked using structured bindings. For example:
+        //     for(auto [movement, transform] : world->query<MovementComponent, Transform>()) { ... }
+        // Only the entities in the smallest component storage are visited, so rare components are cheap to query.
+        template<typename... Ts>
+        Query<Ts...> query();
+
         // This returns and immutable reference to the set of all entites in the world.
-        const std::unordered_set<Entity*>& getEntities() {
+        // NOTE: The order of the entities changes when an entity is deleted
+        const std::vector<Entity*>& getEntities() {
             return entities;
         }
 
@@ -42,41 +139,47 @@ namespace our {
         // The elements in the "markedForRemoval" set will be removed and deleted when "deleteMarkedEntities" is called.
         void markForRemoval(Entity* entity){
             //TODO: (Req 8) If the entity is in this world, add it to the "markedForRemoval" set.
-            auto it = entities.find(entity);
+            // The flag on the entity prevents marking it twice, so no search is needed
+            if(entity && entity->world == this && !entity->markedForRemoval){
+                entity->markedForRemoval = true;
+                markedForRemoval.push_back(entity);
+            }
+        }
 
-            if(it != entities.end())
-                markedForRemoval.insert(entity);
+        // The same as above but the entity is given by its handle (nothing happens if the entity was already deleted)
+        void markForRemoval(EntityId id){
+            markForRemoval(get(id));
         }
 
         // This removes the elements in "markedForRemoval" from the "entities" set.
         // Then each of these elements are deleted.
         void deleteMarkedEntities(){
             //TODO: (Req 8) Remove and delete all the entities that have been marked for removal
-            auto it = markedForRemoval.begin();
-
-            while (it != markedForRemoval.end())
-            {
-                entities.erase(entities.find(*it));
-                delete *it;
-                ++it;
-            }
+            for(auto entity : markedForRemoval)
+                destroy(entity);
 
             markedForRemoval.clear();
         }
 
         //This deletes all entities in the world
+        // The entities and their components are destroyed, then the pools are reset at once (their memory is kept for reuse)
         void clear(){
             //TODO: (Req 8) Delete all the entites and make sure that the containers are empty
-            auto it = entities.begin();
-
-            while (it != entities.end())
-            {
-                delete *it;
-                ++it;
-            }
+            for(auto entity : entities)
+                entity->~Entity();
 
             entities.clear();
             markedForRemoval.clear();
+            for(auto& storage : storages) storage.clear();
+            // We keep the slots so that the handles of the deleted entities stay invalid
+            freeIndices.clear();
+            for(std::uint32_t index = (std::uint32_t)slots.size(); index-- > 0;){
+                EntitySlot& slot = slots[index];
+                if(slot.entity) release(index);
+                else if(slot.generation < ENTITY_GENERATION_MASK) freeIndices.push_back(index);
+            }
+            entityPool.reset();
+            for(auto& pool : componentPools) if(pool) pool->reset();
         }
 
         //Since the world owns all of its entities, they should be deleted alongside it.
@@ -89,4 +192,100 @@ namespace our {
         World &operator=(World const &) = delete;
     };
 
-}
\ No newline at end of file
+    // A view over the entities of a world that have all the components in "Ts" (see "World::query")
+    // It walks the dense arrays of the smallest storage of the queried component types, so the components of that type
+    // are read in order and the entity is not touched unless "Entity" or "Transform" is queried.
+    // The other component types are found with a lookup in their own storage using the entity index.
+    template<typename... Ts>
+    class Query {
+        static_assert((std::is_base_of<Component, Ts>::value || ...), "A query must contain at least one component type");
+        static constexpr size_t TYPE_COUNT = sizeof...(Ts);
+    public:
+        typedef std::array<const ComponentStorage*, TYPE_COUNT> Storages;
+    private:
+
+        const ComponentStorage* candidates; // The smallest storage of the queried component types (its owners may match the query)
+        Storages storages; // The storage of each queried type (nullptr for "Transform" and "Entity" which are not components)
+        size_t first, last; // The range of the candidates visited by this view
+
+    public:
+        Query(const ComponentStorage* candidates, const Storages& storages)
+            : candidates(candidates), storages(storages), first(0), last(candidates->size()) {}
+
+        // Returns the number of candidates visited by this view (an upper bound of the number of matching entities)
+        size_t getCandidateCount() const { return last - first; }
+
+        // Returns a view over the candidates in the range [begin, end) of this view.
+        // The slices can be iterated on different threads to split the work of a system (see "ThreadPool::parallelFor")
+        Query slice(size_t begin, size_t end) const {
+            Query query = *this;
+            query.first = first + begin;
+            query.last = first + std::min(end, last - first);
+            return query;
+        }
+
+        class Iterator {
+            const ComponentStorage* candidates;
+            Storages storages;
+            size_t position, last;
+            std::array<Component*, TYPE_COUNT> found; // The components of the current entity (found by "skip")
+
+            // Finds the components of the candidate at "position". Returns false if it is missing one of them
+            bool match() {
+                std::uint32_t entityIndex = candidates->getEntityIndices()[position];
+                for(size_t type = 0; type < TYPE_COUNT; type++){
+                    if(storages[type] == nullptr) continue;
+                    if(storages[type] == candidates) found[type] = candidates->getComponents()[position];
+                    else if((found[type] = storages[type]->get(entityIndex)) == nullptr) return false;
+                }
+                return true;
+            }
+
+            // Moves forward until we reach an entity that has all the queried components
+            void skip() {
+                while(position < last && !match()) position++;
+            }
+
+            // Returns a pointer to the queried type at the index "I" of "Ts"
+            template<typename T, size_t I>
+            T* fetch() const {
+                if constexpr (std::is_same<T, Entity>::value) return candidates->getEntities()[position];
+                else if constexpr (std::is_same<T, Transform>::value) return &candidates->getEntities()[position]->localTransform;
+                else return static_cast<T*>(found[I]);
+            }
+
+            template<size_t... Is>
+            std::tuple<Ts*...> get(std::index_sequence<Is...>) const {
+                return std::tuple<Ts*...>(fetch<Ts, Is>()...);
+            }
+        public:
+            Iterator(const ComponentStorage* candidates, const Storages& storages, size_t position, size_t last)
+                : candidates(candidates), storages(storages), position(position), last(last) { skip(); }
+
+            std::tuple<Ts*...> operator*() const { return get(std::index_sequence_for<Ts...>()); }
+            Iterator& operator++() { position++; skip(); return *this; }
+            bool operator!=(const Iterator& other) const { return position != other.position; }
+            bool operator==(const Iterator& other) const { return position == other.position; }
+        };
+
+        Iterator begin() const { return Iterator(candidates, storages, first, last); }
+        Iterator end() const { return Iterator(candidates, storages, last, last); }
+    };
+
+    template<typename... Ts>
+    Query<Ts...> World::query() {
+        // Find the storage of each queried component type and pick the smallest one as the candidates
+        const ComponentStorage* candidates = nullptr;
+        auto find = [&](auto* type) -> const ComponentStorage* {
+            using T = std::remove_pointer_t<decltype(type)>;
+            if constexpr (std::is_base_of<Component, T>::value) {
+                const ComponentStorage* storage = &storages[ComponentTypes::get<T>()];
+                if(candidates == nullptr || storage->size() < candidates->size()) candidates = storage;
+                return storage;
+            } else return nullptr;
+        };
+        typename Query<Ts...>::Storages queried = { find((Ts*)nullptr)... };
+        return Query<Ts...>(candidates, queried);
+    }
+
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace our {
+
+    // A fixed capacity array whose memory comes from a FrameAllocator. It is only valid until the allocator is reset,
+    // and since the allocator never runs destructors, it can only hold trivially destructible types.
+    template<typename T>
+    class FrameArray {
+        static_assert(std::is_trivially_destructible<T>::value, "A frame array can only hold trivially destructible types");
+        T* elements = nullptr;
+        size_t count = 0, capacity = 0;
+    public:
+        FrameArray() = default;
+        FrameArray(T* elements, size_t capacity) : elements(elements), capacity(capacity) {}
+
+        void push_back(const T& value) {
+            assert(count < capacity && "The frame array is full");
+            elements[count++] = value;
+        }
+        // Sets the number of elements (it must not exceed the capacity). The new elements are not initialized
+        void resize(size_t size) {
+            assert(size <= capacity && "The frame array is full");
+            count = size;
+        }
+        void clear() { count = 0; }
+
+        T* data() { return elements; }
+        const T* data() const { return elements; }
+        size_t size() const { return count; }
+        size_t getCapacity() const { return capacity; }
+        bool empty() const { return count == 0; }
+
+        T& operator[](size_t index) { return elements[index]; }
+        const T& operator[](size_t index) const { return elements[index]; }
+        T* begin() { return elements; }
+        T* end() { return elements + count; }
+        const T* begin() const { return elements; }
+        const T* end() const { return elements + count; }
+    };
+
+    // A linear (bump) allocator for the data that only lives for one frame.
+    // Allocating moves a pointer forward in one big buffer and everything is freed at once by "reset" at the start of the next frame,
+    // so there are no heap allocations in the frame loop once the buffer is big enough.
+    // The pointer is atomic so the jobs of a thread pool can allocate from the same allocator.
+    // If the buffer is full, the allocation falls back to the heap and the buffer is grown on the next reset to fit the peak usage.
+    class FrameAllocator {
+        static constexpr size_t BUFFER_ALIGNMENT = 64;
+
+        std::byte* buffer = nullptr;
+        size_t capacity = 0;
+        std::atomic<size_t> offset{0};
+        // The heap allocations made when the buffer was full (freed on reset)
+        std::mutex overflowMutex;
+        std::vector<std::pair<void*, size_t>> overflowBlocks; // Each block with its alignment
+        size_t overflowBytes = 0;
+        // The number of bytes used in the last frame and the largest number of bytes used by a frame
+        size_t lastFrameBytes = 0, peakFrameBytes = 0;
+
+        void allocateBuffer(size_t size) {
+            if(buffer) ::operator delete(buffer, std::align_val_t(BUFFER_ALIGNMENT));
+            capacity = size;
+            buffer = capacity ? static_cast<std::byte*>(::operator new(capacity, std::align_val_t(BUFFER_ALIGNMENT))) : nullptr;
+        }
+
+        void freeOverflow() {
+            for(auto& [block, alignment] : overflowBlocks) ::operator delete(block, std::align_val_t(alignment));
+            overflowBlocks.clear();
+            overflowBytes = 0;
+        }
+
+    public:
+        explicit FrameAllocator(size_t capacity = 1 << 20) { allocateBuffer(capacity); }
+
+        ~FrameAllocator() {
+            freeOverflow();
+            allocateBuffer(0);
+        }
+
+        // Returns "size" bytes aligned to "alignment" (a power of 2 not larger than 64) which stay valid until the next reset
+        void* allocate(size_t size, size_t alignment = alignof(std::max_align_t)) {
+            size_t current = offset.load(std::memory_order_relaxed), start, end;
+            do {
+                start = (current + alignment - 1) & ~(alignment - 1);
+                end = start + size;
+            } while(!offset.compare_exchange_weak(current, end, std::memory_order_relaxed));
+            if(end <= capacity) return buffer + start;
+            // The buffer is full so we use the heap for this frame
+            std::lock_guard<std::mutex> lock(overflowMutex);
+            void* block = ::operator new(size, std::align_val_t(alignment));
+            overflowBlocks.emplace_back(block, alignment);
+            overflowBytes += size;
+            return block;
+        }
+
+        // Returns an empty array that can hold up to "capacity" elements
+        template<typename T>
+        FrameArray<T> allocateArray(size_t capacity) {
+            if(capacity == 0) return FrameArray<T>();
+            return FrameArray<T>(static_cast<T*>(allocate(capacity * sizeof(T), alignof(T))), capacity);
+        }
+
+        // Frees everything allocated since the last reset. This must be called when none of the allocations is used anymore.
+        // Usually, it only stores 0 in the pointer. If the last frame didn't fit in the buffer, the buffer is grown first
+        void reset() {
+            lastFrameBytes = std::min(offset.load(std::memory_order_relaxed), capacity) + overflowBytes;
+            peakFrameBytes = std::max(peakFrameBytes, lastFrameBytes);
+            if(!overflowBlocks.empty()){
+                freeOverflow();
+                allocateBuffer(std::max(capacity * 2, peakFrameBytes));
+            }
+            offset.store(0, std::memory_order_relaxed);
+        }
+
+        size_t getCapacity() const { return capacity; }
+        // Returns the number of bytes allocated by the last frame (measured on reset)
+        size_t getLastFrameBytes() const { return lastFrameBytes; }
+        // Returns the largest number of bytes allocated by a frame so far
+        size_t getPeakFrameBytes() const { return peakFrameBytes; }
+
+        FrameAllocator(const FrameAllocator&) = delete;
+        FrameAllocator& operator=(const FrameAllocator&) = delete;
+    };
+
+}
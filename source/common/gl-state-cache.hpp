@@ -0,0 +1,202 @@
+#pragma once
+
+#include <cstdint>
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+namespace our {
+
+    // The number of state calls that were sent to OpenGL and the number of calls that were skipped
+    // because the requested value was already set
+    struct GLStateStatistics {
+        std::uint64_t issued = 0;
+        std::uint64_t skipped = 0;
+        // The same counters for the texture and sampler bindings (including the active texture unit changes)
+        std::uint64_t binds = 0;
+        std::uint64_t skippedBinds = 0;
+    };
+
+    // This static class shadows the OpenGL pipeline state that is set by "PipelineState::setup" and the renderer.
+    // Every function compares the requested value with the last value sent to OpenGL and only issues the call if they differ.
+    // Since the cache cannot see the calls done directly through OpenGL, any code that changes these states without using
+    // this class must call "invalidate" afterwards so that the next call of each state is sent to OpenGL.
+    // It also shadows the active texture unit and the texture and sampler bound to each unit (used by "Texture2D", "TextureBuffer" and "Sampler").
+    // OpenGL keeps a separate texture binding for each target of a unit, so the GL_TEXTURE_2D and GL_TEXTURE_BUFFER bindings are shadowed separately.
+    class GLStateCache {
+        // A value that is never a valid enum, boolean or object name, so that the cached state never matches after "invalidate"
+        static constexpr GLenum UNKNOWN = 0xFFFFFFFF;
+        // The number of texture units that are shadowed. Bindings to higher units are always sent to OpenGL
+        static constexpr GLuint MAX_TEXTURE_UNITS = 16;
+
+        static inline GLenum cullFaceEnabled = UNKNOWN, depthTestEnabled = UNKNOWN, blendEnabled = UNKNOWN;
+        static inline GLenum culledFace = UNKNOWN, frontFaceOrientation = UNKNOWN, depthFunction = UNKNOWN;
+        static inline GLenum blendEquationMode = UNKNOWN;
+        static inline GLenum blendSourceRGB = UNKNOWN, blendDestinationRGB = UNKNOWN, blendSourceAlpha = UNKNOWN, blendDestinationAlpha = UNKNOWN;
+        static inline glm::vec4 blendConstantColor = glm::vec4(-1.0f); // Colors are clamped to [0, 1] so -1 is never requested
+        static inline GLenum colorWriteMask = UNKNOWN, depthWriteMask = UNKNOWN;
+        static inline GLuint activeTextureUnit = UNKNOWN;
+        static inline GLuint boundTextures[MAX_TEXTURE_UNITS] = {UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN,
+                                                                 UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN};
+        static inline GLuint boundBufferTextures[MAX_TEXTURE_UNITS] = {UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN,
+                                                                       UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN};
+        static inline GLuint boundSamplers[MAX_TEXTURE_UNITS] = {UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN,
+                                                                 UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN};
+        static inline GLStateStatistics statistics;
+
+        // Same as "update" but for the binding counters
+        static bool updateBinding(GLuint& slot, GLuint value) {
+            if(slot == value){
+                statistics.skippedBinds++;
+                return false;
+            }
+            slot = value;
+            statistics.binds++;
+            return true;
+        }
+
+        // Returns the array that shadows the bindings of the given texture target (or nullptr if it is not shadowed)
+        static GLuint* textureBindings(GLenum target) {
+            switch(target){
+                case GL_TEXTURE_2D: return boundTextures;
+                case GL_TEXTURE_BUFFER: return boundBufferTextures;
+                default: return nullptr;
+            }
+        }
+
+        // Returns the slot that shadows the given capability (or nullptr if it is not shadowed)
+        static GLenum* capabilitySlot(GLenum capability) {
+            switch(capability){
+                case GL_CULL_FACE: return &cullFaceEnabled;
+                case GL_DEPTH_TEST: return &depthTestEnabled;
+                case GL_BLEND: return &blendEnabled;
+                default: return nullptr;
+            }
+        }
+
+        // Stores the value in the slot and returns true if the call should be sent to OpenGL
+        template<typename T>
+        static bool update(T& slot, const T& value) {
+            if(slot == value){
+                statistics.skipped++;
+                return false;
+            }
+            slot = value;
+            statistics.issued++;
+            return true;
+        }
+
+    public:
+        // Forgets all the cached values. It should be called whenever the OpenGL state was changed outside of this class
+        static void invalidate() {
+            cullFaceEnabled = depthTestEnabled = blendEnabled = UNKNOWN;
+            culledFace = frontFaceOrientation = depthFunction = UNKNOWN;
+            blendEquationMode = UNKNOWN;
+            blendSourceRGB = blendDestinationRGB = blendSourceAlpha = blendDestinationAlpha = UNKNOWN;
+            blendConstantColor = glm::vec4(-1.0f);
+            colorWriteMask = depthWriteMask = UNKNOWN;
+            activeTextureUnit = UNKNOWN;
+            for(GLuint unit = 0; unit < MAX_TEXTURE_UNITS; unit++)
+                boundTextures[unit] = boundBufferTextures[unit] = boundSamplers[unit] = UNKNOWN;
+        }
+
+        // Enables or disables a capability. Capabilities other than culling, depth testing and blending are not shadowed
+        static void setEnabled(GLenum capability, bool enabled) {
+            GLenum* slot = capabilitySlot(capability);
+            if(slot && !update(*slot, (GLenum)enabled)) return;
+            if(!slot) statistics.issued++;
+            if(enabled) glEnable(capability); else glDisable(capability);
+        }
+
+        static void cullFace(GLenum face) {
+            if(update(culledFace, face)) glCullFace(face);
+        }
+
+        static void frontFace(GLenum orientation) {
+            if(update(frontFaceOrientation, orientation)) glFrontFace(orientation);
+        }
+
+        static void depthFunc(GLenum function) {
+            if(update(depthFunction, function)) glDepthFunc(function);
+        }
+
+        static void blendEquation(GLenum equation) {
+            if(update(blendEquationMode, equation)) glBlendEquation(equation);
+        }
+
+        // glBlendFunc is the same as glBlendFuncSeparate with the same factors for the color and alpha
+        static void blendFunc(GLenum source, GLenum destination) {
+            blendFuncSeparate(source, destination, source, destination);
+        }
+
+        static void blendFuncSeparate(GLenum sourceRGB, GLenum destinationRGB, GLenum sourceAlpha, GLenum destinationAlpha) {
+            // We compare the four factors as a single call since they are sent together
+            bool changed = sourceRGB != blendSourceRGB || destinationRGB != blendDestinationRGB ||
+                           sourceAlpha != blendSourceAlpha || destinationAlpha != blendDestinationAlpha;
+            if(!changed){
+                statistics.skipped++;
+                return;
+            }
+            blendSourceRGB = sourceRGB; blendDestinationRGB = destinationRGB;
+            blendSourceAlpha = sourceAlpha; blendDestinationAlpha = destinationAlpha;
+            statistics.issued++;
+            glBlendFuncSeparate(sourceRGB, destinationRGB, sourceAlpha, destinationAlpha);
+        }
+
+        static void blendColor(const glm::vec4& color) {
+            if(update(blendConstantColor, color)) glBlendColor(color.r, color.g, color.b, color.a);
+        }
+
+        static void colorMask(bool r, bool g, bool b, bool a) {
+            // The 4 booleans are packed in 4 bits so that we can compare them at once
+            GLenum mask = (r ? 1 : 0) | (g ? 2 : 0) | (b ? 4 : 0) | (a ? 8 : 0);
+            if(update(colorWriteMask, mask)) glColorMask(r, g, b, a);
+        }
+
+        static void depthMask(bool enabled) {
+            if(update(depthWriteMask, (GLenum)enabled)) glDepthMask(enabled);
+        }
+
+        // Selects the active texture unit (the unit is given as an index, not as GL_TEXTURE0 + index)
+        static void activeTexture(GLuint unit) {
+            if(updateBinding(activeTextureUnit, unit)) glActiveTexture(GL_TEXTURE0 + unit);
+        }
+
+        // Binds the given texture to the given target of the active texture unit.
+        // Only GL_TEXTURE_2D and GL_TEXTURE_BUFFER are shadowed, the other targets are always sent to OpenGL
+        static void bindTexture(GLenum target, GLuint texture) {
+            GLuint* bindings = textureBindings(target);
+            if(bindings && activeTextureUnit < MAX_TEXTURE_UNITS){
+                if(!updateBinding(bindings[activeTextureUnit], texture)) return;
+            } else statistics.binds++;
+            glBindTexture(target, texture);
+        }
+
+        // Binds the given texture to GL_TEXTURE_2D of the active texture unit
+        static void bindTexture2D(GLuint texture) {
+            bindTexture(GL_TEXTURE_2D, texture);
+        }
+
+        static void bindSampler(GLuint unit, GLuint sampler) {
+            if(unit < MAX_TEXTURE_UNITS){
+                if(!updateBinding(boundSamplers[unit], sampler)) return;
+            } else statistics.binds++;
+            glBindSampler(unit, sampler);
+        }
+
+        // OpenGL unbinds a texture or a sampler from all the units when it is deleted and its name could be reused by a new object.
+        // So these functions must be called when an object is deleted to mark the units that held it as empty
+        static void forgetTexture(GLuint texture) {
+            for(GLuint& bound : boundTextures) if(bound == texture) bound = 0;
+            for(GLuint& bound : boundBufferTextures) if(bound == texture) bound = 0;
+        }
+
+        static void forgetSampler(GLuint sampler) {
+            for(GLuint& bound : boundSamplers) if(bound == sampler) bound = 0;
+        }
+
+        // Returns the counters of the issued and skipped state calls since the last call of "resetStatistics"
+        static const GLStateStatistics& getStatistics() { return statistics; }
+        static void resetStatistics() { statistics = GLStateStatistics(); }
+    };
+
+}
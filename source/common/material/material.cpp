@@ -8,12 +8,35 @@
 namespace our
 {
 
+    // The handles of the uniforms sent by the materials (created once so that "setup" does not build any strings)
+    namespace uniforms
+    {
+        const UniformHandle TINT("tint");
+        const UniformHandle MATERIAL_DIFFUSE("material.diffuse");
+        const UniformHandle MATERIAL_SPECULAR("material.specular");
+        const UniformHandle MATERIAL_AMBIENT("material.ambient");
+        const UniformHandle MATERIAL_EMISSIVE("material.emissive");
+        const UniformHandle MATERIAL_SHININESS("material.shininess");
+        const UniformHandle ALPHA("alpha");
+        const UniformHandle ALPHA_THRESHOLD("alphaThreshold");
+        const UniformHandle TEX("tex");
+        const UniformHandle TEX_MATERIAL_ROUGHNESS_RANGE("tex_material.roughness_range");
+        const UniformHandle TEX_MATERIAL_ALBEDO_TINT("tex_material.albedo_tint");
+        const UniformHandle TEX_MATERIAL_SPECULAR_TINT("tex_material.specular_tint");
+        const UniformHandle TEX_MATERIAL_EMISSIVE_TINT("tex_material.emissive_tint");
+        const UniformHandle TEX_MATERIAL_ALBEDO_MAP("tex_material.albedo_map");
+        const UniformHandle TEX_MATERIAL_SPECULAR_MAP("tex_material.specular_map");
+        const UniformHandle TEX_MATERIAL_AMBIENT_OCCLUSION_MAP("tex_material.ambient_occlusion_map");
+        const UniformHandle TEX_MATERIAL_ROUGHNESS_MAP("tex_material.roughness_map");
+        const UniformHandle TEX_MATERIAL_EMISSIVE_MAP("tex_material.emissive_map");
+    }
+
     // This function should setup the pipeline state and set the shader to be used
-    void Material::setup() const
+    void Material::setup(ShaderVariant variant) const
     {
         // TODO: (Req 7) Write this function
-        pipelineState.setup(); // setup the pipline
-        shader->use();         // to use the shader
+        pipelineState.setup();           // setup the pipline
+        getShader(variant)->use();       // to use the shader (or one of its variants)
     }
 
     // This function read the material data from a json object
@@ -27,12 +50,16 @@ namespace our
             pipelineState.deserialize(data["pipelineState"]);
         }
         shader = AssetLoader<ShaderProgram>::get(data["shader"].get<std::string>());
+        // The instanced variant of the shader is optional. Without it, the renderer draws the objects one by one
+        instancedShader = AssetLoader<ShaderProgram>::get(data.value("instancedShader", ""));
+        // The same goes for the order independent transparency variant. Without it, the object is drawn by the sorted transparent pass
+        oitShader = AssetLoader<ShaderProgram>::get(data.value("oitShader", ""));
         transparent = data.value("transparent", false);
     }
 
-    void LitMaterial::setup() const
+    void LitMaterial::setup(ShaderVariant variant) const
     {
-        Material::setup();
+        Material::setup(variant);
 
         /*TODO (req Light): SEND NEEDED DATA TO SHADER*/
     }
@@ -53,11 +80,12 @@ namespace our
 
     // This function should call the setup of its parent and
     // set the "tint" uniform to the value in the member variable tint
-    void TintedMaterial::setup() const
+    void TintedMaterial::setup(ShaderVariant variant) const
     {
         // TODO: (Req 7) Write this function
-        Material::setup();         // call the setup of its parent
-        shader->set("tint", tint); // set the tint
+        Material::setup(variant);         // call the setup of its parent
+        ShaderProgram *program = getShader(variant);
+        program->set(uniforms::TINT, tint); // set the tint
     }
 
     // This function read the material data from a json object
@@ -70,16 +98,17 @@ namespace our
     }
 
     //This function calls the setup of its parent and pass the nedded data to the shaders
-    void LitTintedMaterial::setup() const
+    void LitTintedMaterial::setup(ShaderVariant variant) const
     {
-        LitMaterial::setup();
+        LitMaterial::setup(variant);
+        ShaderProgram *program = getShader(variant);
         //TODO: (Light) SEND NEEDED DATA TO SHADER
-        shader->set("material.diffuse", glm::vec3(albedo_tint.r, albedo_tint.g, albedo_tint.b));
-        shader->set("material.specular", glm::vec3(specular.r, specular.g, specular.b));
-        shader->set("material.ambient", glm::vec3(ambient.r, ambient.g, ambient.b));
-        shader->set("material.emissive", glm::vec3(emissive_tint.r, emissive_tint.g, emissive_tint.b));
-        shader->set("material.shininess", shininess);
-        shader->set("alpha", ambient.a);
+        program->set(uniforms::MATERIAL_DIFFUSE, glm::vec3(albedo_tint.r, albedo_tint.g, albedo_tint.b));
+        program->set(uniforms::MATERIAL_SPECULAR, glm::vec3(specular.r, specular.g, specular.b));
+        program->set(uniforms::MATERIAL_AMBIENT, glm::vec3(ambient.r, ambient.g, ambient.b));
+        program->set(uniforms::MATERIAL_EMISSIVE, glm::vec3(emissive_tint.r, emissive_tint.g, emissive_tint.b));
+        program->set(uniforms::MATERIAL_SHININESS, shininess);
+        program->set(uniforms::ALPHA, ambient.a);
 
     }
 
@@ -97,13 +126,14 @@ namespace our
     // This function should call the setup of its parent and
     // set the "alphaThreshold" uniform to the value in the member variable alphaThreshold
     // Then it should bind the texture and sampler to a texture unit and send the unit number to the uniform variable "tex"
-    void TexturedMaterial::setup() const
+    void TexturedMaterial::setup(ShaderVariant variant) const
     {
         // TODO: (Req 7) Write this function
-        TintedMaterial::setup();                       // call the setup of its parent
-        shader->set("alphaThreshold", alphaThreshold); // set the "alphaThreshold" uniform to the value in the member variable alphaThreshold
+        TintedMaterial::setup(variant);                       // call the setup of its parent
+        ShaderProgram *program = getShader(variant);
+        program->set(uniforms::ALPHA_THRESHOLD, alphaThreshold); // set the "alphaThreshold" uniform to the value in the member variable alphaThreshold
         //Specifies which texture unit to make active
-        glActiveTexture(GL_TEXTURE0);
+        GLStateCache::activeTexture(0);
         if (texture)
             texture->bind(); // check if the texture is not null then bind it
         else
@@ -112,7 +142,7 @@ namespace our
             sampler->bind(0); // check if sampler is not null then bind it
         else
             Sampler::unbind(0); //if null unbind
-        shader->set("tex", 0); // send the unit number to the uniform variable "tex"
+        program->set(uniforms::TEX, 0); // send the unit number to the uniform variable "tex"
     }
 
     // This function read the material data from a json object
@@ -122,22 +152,23 @@ namespace our
         if (!data.is_object())
             return;
         alphaThreshold = data.value("alphaThreshold", 0.0f);
-        texture = AssetLoader<Texture2D>::get(data.value("texture", ""));
+        texture = AssetLoader<Texture2D>::getAsync(data.value("texture", ""));
         sampler = AssetLoader<Sampler>::get(data.value("sampler", ""));
     }
 
     //This function calls the setup of its parent and pass the needed data to the shader
-    void LitTexturedMaterial::setup() const
+    void LitTexturedMaterial::setup(ShaderVariant variant) const
     {
-        LitTintedMaterial::setup();
+        LitTintedMaterial::setup(variant);
+        ShaderProgram *program = getShader(variant);
         //TODO: (Light) SEND NEEDED DATA TO SHADER
-        shader->set("tex_material.roughness_range", roughness_range);
-        shader->set("tex_material.albedo_tint", glm::vec3(albedo_tint.r, albedo_tint.g, albedo_tint.b));
-        shader->set("tex_material.specular_tint", glm::vec3(specular_tint.r, specular_tint.g, specular_tint.b));
-        shader->set("tex_material.emissive_tint", glm::vec3(emissive_tint.r, emissive_tint.g, emissive_tint.b));
-        shader->set("alphaThreshold", alphaThreshold); // set the "alphaThreshold" uniform to the value in the member variable alphaThreshold
+        program->set(uniforms::TEX_MATERIAL_ROUGHNESS_RANGE, roughness_range);
+        program->set(uniforms::TEX_MATERIAL_ALBEDO_TINT, glm::vec3(albedo_tint.r, albedo_tint.g, albedo_tint.b));
+        program->set(uniforms::TEX_MATERIAL_SPECULAR_TINT, glm::vec3(specular_tint.r, specular_tint.g, specular_tint.b));
+        program->set(uniforms::TEX_MATERIAL_EMISSIVE_TINT, glm::vec3(emissive_tint.r, emissive_tint.g, emissive_tint.b));
+        program->set(uniforms::ALPHA_THRESHOLD, alphaThreshold); // set the "alphaThreshold" uniform to the value in the member variable alphaThreshold
         //Specifies which texture unit to make active
-        glActiveTexture(GL_TEXTURE0);
+        GLStateCache::activeTexture(0);
         if (albedo_map)
         {
             albedo_map->bind(); // check if the texture is not null then bind it
@@ -154,9 +185,9 @@ namespace our
         {
             Sampler::unbind(0); //if null unbind
         }
-        shader->set("tex_material.albedo_map", 0);
+        program->set(uniforms::TEX_MATERIAL_ALBEDO_MAP, 0);
         //Specifies which texture unit to make active
-        glActiveTexture(GL_TEXTURE0 + 1);
+        GLStateCache::activeTexture(1);
         if (specular_map)
         {
             specular_map->bind(); // check if the texture is not null then bind it
@@ -173,9 +204,9 @@ namespace our
         {
             Sampler::unbind(1); //if null unbind
         }
-        shader->set("tex_material.specular_map", 1);
+        program->set(uniforms::TEX_MATERIAL_SPECULAR_MAP, 1);
         //Specifies which texture unit to make active
-        glActiveTexture(GL_TEXTURE0 + 2);
+        GLStateCache::activeTexture(2);
         if (ambient_occlusion_map)
         {
             ambient_occlusion_map->bind(); // check if the texture is not null then bind it
@@ -188,9 +219,9 @@ namespace our
             ambient_occlusion_sampler->bind(2); // check if sampler is not null then bind it
         else
             Sampler::unbind(2); //if null unbind
-        shader->set("tex_material.ambient_occlusion_map", 2);
+        program->set(uniforms::TEX_MATERIAL_AMBIENT_OCCLUSION_MAP, 2);
         //Specifies which texture unit to make active
-        glActiveTexture(GL_TEXTURE0 + 3);
+        GLStateCache::activeTexture(3);
         if (roughness_map)
         {
             roughness_map->bind(); // check if the texture is not null then bind it
@@ -201,9 +232,9 @@ namespace our
             roughness_sampler->bind(3); // check if sampler is not null then bind it
         else
             Sampler::unbind(3); //if null unbind
-        shader->set("tex_material.roughness_map", 3);
+        program->set(uniforms::TEX_MATERIAL_ROUGHNESS_MAP, 3);
         //Specifies which texture unit to make active
-        glActiveTexture(GL_TEXTURE0 + 4);
+        GLStateCache::activeTexture(4);
         if (emissive_map)
         {
             emissive_map->bind(); // check if the texture is not null then bind it
@@ -214,9 +245,9 @@ namespace our
             emissive_sampler->bind(4); // check if sampler is not null then bind it
         else
             Sampler::unbind(4); //if null unbind
-        shader->set("tex_material.emissive_map", 4);
+        program->set(uniforms::TEX_MATERIAL_EMISSIVE_MAP, 4);
         //Specifies which texture unit to make active
-        glActiveTexture(GL_TEXTURE0 + 5);
+        GLStateCache::activeTexture(5);
         if (texture)
             texture->bind(); // check if the texture is not null then bind it
         else
@@ -225,7 +256,7 @@ namespace our
             sampler->bind(5); // check if sampler is not null then bind it
         else
             Sampler::unbind(5); //if null unbind
-        shader->set("tex", 5); // send the unit number to the uniform variable "tex"
+        program->set(uniforms::TEX, 5); // send the unit number to the uniform variable "tex"
 
     }
 
@@ -236,18 +267,18 @@ namespace our
         if (!data.is_object())
             return;
 
-        albedo_map = AssetLoader<Texture2D>::get(data.value("albedo_map", ""));
+        albedo_map = AssetLoader<Texture2D>::getAsync(data.value("albedo_map", ""));
         albedo_sampler = AssetLoader<Sampler>::get(data.value("albedo_sampler", ""));
-        specular_map = AssetLoader<Texture2D>::get(data.value("specular_map", ""));
+        specular_map = AssetLoader<Texture2D>::getAsync(data.value("specular_map", ""));
         specular_sampler = AssetLoader<Sampler>::get(data.value("specular_sampler", ""));
-        roughness_map = AssetLoader<Texture2D>::get(data.value("roughness_map", ""));
+        roughness_map = AssetLoader<Texture2D>::getAsync(data.value("roughness_map", ""));
         roughness_sampler = AssetLoader<Sampler>::get(data.value("roughness_sampler", ""));
         roughness_range = data.value("roughness_range", glm::vec2(0.0f, 1.0f));
-        ambient_occlusion_map = AssetLoader<Texture2D>::get(data.value("ambient_occlusion_map", ""));
+        ambient_occlusion_map = AssetLoader<Texture2D>::getAsync(data.value("ambient_occlusion_map", ""));
         ambient_occlusion_sampler = AssetLoader<Sampler>::get(data.value("ambient_occlusion_sampler", ""));
-        emissive_map = AssetLoader<Texture2D>::get(data.value("emissive_map", ""));
+        emissive_map = AssetLoader<Texture2D>::getAsync(data.value("emissive_map", ""));
         emissive_sampler = AssetLoader<Sampler>::get(data.value("emissive_sampler", ""));
-        texture = AssetLoader<Texture2D>::get(data.value("texture", ""));
+        texture = AssetLoader<Texture2D>::getAsync(data.value("texture", ""));
         sampler = AssetLoader<Sampler>::get(data.value("sampler", ""));
 
         alphaThreshold = data.value("alphaThreshold", 0.0f);
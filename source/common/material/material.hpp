@@ -4,13 +4,22 @@
 #include "../texture/texture2d.hpp"
 #include "../texture/sampler.hpp"
 #include "../shader/shader.hpp"
+#include "../asset-loader.hpp"
 
 #include <glm/vec4.hpp>
 #include <glm/vec2.hpp>
 #include <json/json.hpp>
+#include <cstdint>
 
 namespace our {
 
+    // The variants of the shader of a material. The renderer picks a variant depending on how the object is drawn
+    enum class ShaderVariant {
+        DEFAULT,   // The normal shader
+        INSTANCED, // Reads the object to world matrix from a per-instance attribute (see "Mesh::drawInstanced")
+        OIT        // Writes to the weighted blended order independent transparency targets (see "ForwardRenderer")
+    };
+
     // This is the base class for all the materials
     // It contains the 3 essential components required by any material
     // 1- The pipeline state when drawing objects using this material
@@ -18,13 +27,40 @@ namespace our {
     // 3- Whether this material is transparent or not
     // Materials that send uniforms to the shader should inherit from the is material and add the required uniforms
     class Material {
+        // A counter used to give each material a unique small id
+        static inline std::uint32_t nextID = 0;
+        std::uint32_t id = nextID++;
     public:
         PipelineState pipelineState;
         ShaderProgram* shader;
+        // An optional variant of the shader that reads the object to world matrix from a per-instance attribute (see "Mesh::drawInstanced")
+        ShaderProgram* instancedShader = nullptr;
+        // An optional variant of the shader used by the order independent transparency mode of the renderer
+        ShaderProgram* oitShader = nullptr;
         bool transparent;
+
+        // Returns the id of this material (used by the renderer to group the draw calls that use the same material)
+        std::uint32_t getID() const { return id; }
+        
+        // Returns the shader of the given variant (it is null if the material doesn't have this variant)
+        ShaderProgram* getShader(ShaderVariant variant = ShaderVariant::DEFAULT) const {
+            switch(variant){
+                case ShaderVariant::INSTANCED: return instancedShader;
+                case ShaderVariant::OIT: return oitShader;
+                default: return shader;
+            }
+        }
+        // Returns true if the objects using this material can be drawn with a single instanced draw call
+        bool supportsInstancing() const { return instancedShader != nullptr; }
+        // Returns true if the objects using this material can be drawn by the order independent transparency pass
+        bool supportsOIT() const { return oitShader != nullptr; }
+        // Returns true if the shader of this material may discard fragments (e.g. the texels below an alpha threshold).
+        // The depth of these materials can't be written ahead by the depth pre-pass since the pre-pass can't discard the same fragments
+        virtual bool isAlphaTested() const { return false; }
         
         // This function does 2 things: setup the pipeline state and set the shader program to be used
-        virtual void setup() const;
+        // The shader of the given variant is used (it must not be null)
+        virtual void setup(ShaderVariant variant = ShaderVariant::DEFAULT) const;
         // This function read a material from a json object
         virtual void deserialize(const nlohmann::json& data);
     };
@@ -40,7 +76,7 @@ namespace our {
         float shininess;
 
         // This function does 2 things: setup the pipeline state and set the shader program to be used
-        virtual void setup() const;
+        virtual void setup(ShaderVariant variant = ShaderVariant::DEFAULT) const;
         // This function read a material from a json object
         virtual void deserialize(const nlohmann::json& data);
     };
@@ -52,7 +88,7 @@ namespace our {
     public:
         glm::vec4 tint;
 
-        void setup() const override;
+        void setup(ShaderVariant variant = ShaderVariant::DEFAULT) const override;
         void deserialize(const nlohmann::json& data) override;
     };
 
@@ -62,7 +98,7 @@ namespace our {
         glm::vec4 specular_tint;
         glm::vec4 emissive_tint;
 
-        void setup() const override;
+        void setup(ShaderVariant variant = ShaderVariant::DEFAULT) const override;
         void deserialize(const nlohmann::json& data) override;
     };
 
@@ -74,32 +110,33 @@ namespace our {
     //TODO: (Light) Implement Lit Textured Material class
     class TexturedMaterial : public TintedMaterial {
     public:
-        Texture2D* texture;
+        AssetHandle<Texture2D> texture; // A handle since the texture can be a placeholder while it is streamed
         Sampler* sampler;
         float alphaThreshold;
 
-        void setup() const override;
+        bool isAlphaTested() const override { return alphaThreshold > 0.0f; }
+        void setup(ShaderVariant variant = ShaderVariant::DEFAULT) const override;
         void deserialize(const nlohmann::json& data) override;
     };
 
     class LitTexturedMaterial : public LitTintedMaterial {
-            Texture2D* texture;
+            AssetHandle<Texture2D> texture;
             Sampler* sampler;
-            Texture2D* albedo_map;
+            AssetHandle<Texture2D> albedo_map;
             Sampler* albedo_sampler;
-            Texture2D* specular_map;
+            AssetHandle<Texture2D> specular_map;
             Sampler* specular_sampler;
-            Texture2D* roughness_map;
+            AssetHandle<Texture2D> roughness_map;
             Sampler* roughness_sampler;
             glm::vec2 roughness_range; 
-            Texture2D* ambient_occlusion_map; 
+            AssetHandle<Texture2D> ambient_occlusion_map; 
             Sampler* ambient_occlusion_sampler;          
-            Texture2D* emissive_map;
+            AssetHandle<Texture2D> emissive_map;
             Sampler* emissive_sampler;
 
             float alphaThreshold;
 
-            void setup() const override;
+            void setup(ShaderVariant variant = ShaderVariant::DEFAULT) const override;
             void deserialize(const nlohmann::json& data) override;
     };
 
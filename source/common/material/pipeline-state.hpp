@@ -1,9 +1,12 @@
 #pragma once
 
+#include <cstdint>
 #include <glad/gl.h>
 #include <glm/vec4.hpp>
 #include <json/json.hpp>
 
+#include "../gl-state-cache.hpp"
+
 namespace our {
     // There are some options in the render pipeline that we cannot control via shaders
     // such as blending, depth testing and so on
@@ -40,47 +43,40 @@ namespace our {
 
         // This function should set the OpenGL options to the values specified by this structure
         // For example, if faceCulling.enabled is true, you should call glEnable(GL_CULL_FACE), otherwise, you should call glDisable(GL_CULL_FACE)
+        // The calls go through "GLStateCache" which skips the options that are already set to the requested values
         void setup() const {
             //TODO: (Req 4) Write this function
             //faceCulling
-            if(faceCulling.enabled == true)
-            {
-                glEnable(GL_CULL_FACE);
-            }
-            else
-            {
-                glDisable(GL_CULL_FACE);
-            }
-            glCullFace(faceCulling.culledFace);
-            glFrontFace(faceCulling.frontFace);
-            
+            GLStateCache::setEnabled(GL_CULL_FACE, faceCulling.enabled);
+            GLStateCache::cullFace(faceCulling.culledFace);
+            GLStateCache::frontFace(faceCulling.frontFace);
+
             //Depth testing
-            if(depthTesting.enabled == true)
-            {
-                glEnable(GL_DEPTH_TEST);
-            }
-            else
-            {
-                glDisable(GL_DEPTH_TEST); 
-            }
-            glDepthFunc(depthTesting.function);
+            GLStateCache::setEnabled(GL_DEPTH_TEST, depthTesting.enabled);
+            GLStateCache::depthFunc(depthTesting.function);
 
             //Blending
-            if(blending.enabled == true)
-            {
-                glEnable(GL_BLEND);
-            }
-            else
-            {
-                glDisable(GL_BLEND);
-            }
-            glBlendEquation(blending.equation);
-            glBlendFunc(blending.sourceFactor, blending.destinationFactor);
-            glBlendColor(blending.constantColor.r, blending.constantColor.g, blending.constantColor.b, blending.constantColor.a);
+            GLStateCache::setEnabled(GL_BLEND, blending.enabled);
+            GLStateCache::blendEquation(blending.equation);
+            GLStateCache::blendFunc(blending.sourceFactor, blending.destinationFactor);
+            GLStateCache::blendColor(blending.constantColor);
 
             //color/depth mask options
-            glColorMask(colorMask.r, colorMask.g, colorMask.b, colorMask.a);
-            glDepthMask(depthMask);
+            GLStateCache::colorMask(colorMask.r, colorMask.g, colorMask.b, colorMask.a);
+            GLStateCache::depthMask(depthMask);
+        }
+
+        // Returns an 8-bit summary of the options that are most expensive to change (used as the most significant part of the renderer sort key).
+        // Different states can share the same bits since the key is only used to order the draw calls
+        std::uint8_t getSortBits() const {
+            std::uint8_t bits = 0;
+            bits |= (blending.enabled ? 1 : 0) << 7;
+            bits |= (depthTesting.enabled ? 1 : 0) << 6;
+            bits |= (depthMask ? 1 : 0) << 5;
+            bits |= (faceCulling.enabled ? 1 : 0) << 4;
+            bits |= (faceCulling.culledFace == GL_FRONT ? 1 : 0) << 3;
+            bits |= (depthTesting.function - GL_NEVER) & 0x7; // The comparison functions are the consecutive values GL_NEVER..GL_ALWAYS
+            return bits;
         }
 
         // Given a json object, this function deserializes a PipelineState structure
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cmath>
+#include <glm/glm.hpp>
+
+namespace our {
+
+    // An axis aligned bounding box defined by its minimum and maximum corners
+    struct AABB {
+        glm::vec3 min = glm::vec3(0.0f);
+        glm::vec3 max = glm::vec3(0.0f);
+
+        glm::vec3 getCenter() const { return 0.5f * (min + max); }
+        glm::vec3 getExtents() const { return 0.5f * (max - min); }
+
+        // Returns the box that encloses this box after it is transformed by the given matrix.
+        // Instead of transforming the 8 corners, we transform the center and compute the extents
+        // from the absolute values of the matrix (Arvo's method)
+        AABB transformed(const glm::mat4& matrix) const {
+            glm::vec3 center = glm::vec3(matrix * glm::vec4(getCenter(), 1.0f));
+            glm::vec3 extents = getExtents();
+            glm::vec3 newExtents = glm::abs(glm::vec3(matrix[0])) * extents.x +
+                                   glm::abs(glm::vec3(matrix[1])) * extents.y +
+                                   glm::abs(glm::vec3(matrix[2])) * extents.z;
+            return {center - newExtents, center + newExtents};
+        }
+    };
+
+    // A bounding sphere defined by its center and radius
+    struct BoundingSphere {
+        glm::vec3 center = glm::vec3(0.0f);
+        float radius = 0.0f;
+
+        // Returns a sphere that encloses this sphere after it is transformed by the given matrix.
+        // For non-uniform scales, the radius is scaled by the largest scale so the result can be bigger than needed
+        BoundingSphere transformed(const glm::mat4& matrix) const {
+            float scale = std::sqrt(glm::max(glm::max(
+                glm::dot(glm::vec3(matrix[0]), glm::vec3(matrix[0])),
+                glm::dot(glm::vec3(matrix[1]), glm::vec3(matrix[1]))),
+                glm::dot(glm::vec3(matrix[2]), glm::vec3(matrix[2]))));
+            return {glm::vec3(matrix * glm::vec4(center, 1.0f)), radius * scale};
+        }
+    };
+
+    // The 6 planes of a view frustum. Each plane is stored as (a, b, c, d) where a point p is inside if dot((a, b, c), p) + d >= 0
+    // The planes are extracted from a view projection matrix (Gribb & Hartmann method) so they are in world space
+    struct Frustum {
+        glm::vec4 planes[6];
+
+        static Frustum fromMatrix(const glm::mat4& VP) {
+            // We need the rows of the matrix but glm stores the columns
+            glm::mat4 T = glm::transpose(VP);
+            Frustum frustum;
+            frustum.planes[0] = T[3] + T[0]; // Left
+            frustum.planes[1] = T[3] - T[0]; // Right
+            frustum.planes[2] = T[3] + T[1]; // Bottom
+            frustum.planes[3] = T[3] - T[1]; // Top
+            frustum.planes[4] = T[3] + T[2]; // Near
+            frustum.planes[5] = T[3] - T[2]; // Far
+            // Normalize the planes so that the sphere test can compare the signed distance with the radius
+            for(auto& plane : frustum.planes)
+                plane /= glm::length(glm::vec3(plane));
+            return frustum;
+        }
+
+        // Returns false if the sphere is completely outside of the frustum
+        bool intersects(const BoundingSphere& sphere) const {
+            for(const auto& plane : planes)
+                if(glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius)
+                    return false;
+            return true;
+        }
+
+        // Returns false if the box is completely outside of the frustum.
+        // For each plane, we only test the corner that is furthest along the plane normal
+        bool intersects(const AABB& box) const {
+            for(const auto& plane : planes){
+                glm::vec3 corner = glm::vec3(
+                    plane.x >= 0 ? box.max.x : box.min.x,
+                    plane.y >= 0 ? box.max.y : box.min.y,
+                    plane.z >= 0 ? box.max.z : box.min.z
+                );
+                if(glm::dot(glm::vec3(plane), corner) + plane.w < 0)
+                    return false;
+            }
+            return true;
+        }
+    };
+
+}
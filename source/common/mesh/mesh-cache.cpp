@@ -0,0 +1,181 @@
+#include "mesh-cache.hpp"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <type_traits>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static_assert(std::is_trivially_copyable<our::MeshCacheHeader>::value, "The cache header is read directly from the mapped file");
+static_assert(std::is_trivially_copyable<our::Vertex>::value, "The vertices are read directly from the mapped file");
+
+void our::MeshData::computeBounds() {
+    bounds = AABB();
+    boundingSphere = BoundingSphere();
+    if(vertices.empty()) return;
+    bounds.min = bounds.max = vertices[0].position;
+    for(const auto& vertex : vertices){
+        bounds.min = glm::min(bounds.min, vertex.position);
+        bounds.max = glm::max(bounds.max, vertex.position);
+    }
+    boundingSphere.center = bounds.getCenter();
+    float radiusSquared = 0.0f;
+    for(const auto& vertex : vertices){
+        glm::vec3 offset = vertex.position - boundingSphere.center;
+        radiusSquared = glm::max(radiusSquared, glm::dot(offset, offset));
+    }
+    boundingSphere.radius = std::sqrt(radiusSquared);
+}
+
+void our::MappedMeshCache::unmap() {
+#ifdef _WIN32
+    if(mapping) UnmapViewOfFile(mapping);
+    if(mappingHandle) CloseHandle(mappingHandle);
+    if(fileHandle) CloseHandle(fileHandle);
+    fileHandle = mappingHandle = nullptr;
+#else
+    if(mapping) munmap(mapping, mappingSize);
+#endif
+    mapping = nullptr;
+    mappingSize = 0;
+    header = nullptr;
+    vertices = nullptr;
+    elements = nullptr;
+    submeshes = nullptr;
+}
+
+bool our::MappedMeshCache::open(const std::string& path, std::uint64_t sourceHash) {
+    unmap();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(file == INVALID_HANDLE_VALUE) return false;
+    fileHandle = file;
+    LARGE_INTEGER fileSize;
+    if(!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < (LONGLONG)sizeof(MeshCacheHeader)){
+        unmap();
+        return false;
+    }
+    mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if(!mappingHandle){
+        unmap();
+        return false;
+    }
+    mapping = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+    if(!mapping){
+        unmap();
+        return false;
+    }
+    mappingSize = (size_t)fileSize.QuadPart;
+#else
+    int file = ::open(path.c_str(), O_RDONLY);
+    if(file < 0) return false;
+    struct stat fileStat;
+    if(fstat(file, &fileStat) != 0 || fileStat.st_size < (off_t)sizeof(MeshCacheHeader)){
+        ::close(file);
+        return false;
+    }
+    void* address = mmap(nullptr, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    // The mapping keeps its own reference to the file, so we can close the descriptor right away
+    ::close(file);
+    if(address == MAP_FAILED) return false;
+    mapping = address;
+    mappingSize = (size_t)fileStat.st_size;
+#endif
+
+    auto bytes = static_cast<const std::byte*>(mapping);
+    header = reinterpret_cast<const MeshCacheHeader*>(bytes);
+    if(header->magic != MESH_CACHE_MAGIC || header->version != MESH_CACHE_VERSION || header->sourceHash != sourceHash){
+        unmap();
+        return false;
+    }
+    // The sizes are computed in 64 bits so that a corrupted count can't overflow them
+    std::uint64_t verticesSize = (std::uint64_t)header->vertexCount * sizeof(Vertex);
+    std::uint64_t elementsSize = (std::uint64_t)header->elementCount * sizeof(std::uint32_t);
+    std::uint64_t submeshesSize = (std::uint64_t)header->submeshCount * sizeof(Submesh);
+    if(sizeof(MeshCacheHeader) + verticesSize + elementsSize + submeshesSize != mappingSize){
+        unmap();
+        return false;
+    }
+    vertices = reinterpret_cast<const Vertex*>(bytes + sizeof(MeshCacheHeader));
+    elements = reinterpret_cast<const std::uint32_t*>(bytes + sizeof(MeshCacheHeader) + verticesSize);
+    submeshes = reinterpret_cast<const Submesh*>(bytes + sizeof(MeshCacheHeader) + verticesSize + elementsSize);
+    return true;
+}
+
+std::uint64_t our::mesh_cache::hashBytes(const void* data, size_t size) {
+    auto bytes = static_cast<const unsigned char*>(data);
+    std::uint64_t hash = 14695981039346656037ull;
+    for(size_t index = 0; index < size; index++){
+        hash ^= bytes[index];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+bool our::mesh_cache::readFile(const std::string& path, std::string& content) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if(!file) return false;
+    std::streamsize size = file.tellg();
+    if(size < 0) return false;
+    content.resize((size_t)size);
+    file.seekg(0);
+    return (bool)file.read(content.data(), size);
+}
+
+std::string our::mesh_cache::getCachePath(const std::string& sourcePath, std::uint64_t sourceHash, const std::string& directory) {
+    char hashText[17];
+    std::snprintf(hashText, sizeof(hashText), "%016llx", (unsigned long long)sourceHash);
+    std::string stem = std::filesystem::path(sourcePath).stem().string();
+    return (std::filesystem::path(directory) / (stem + "-" + hashText + ".mesh")).string();
+}
+
+bool our::mesh_cache::write(const std::string& path, std::uint64_t sourceHash, const MeshData& data) {
+    MeshCacheHeader header{};
+    header.magic = MESH_CACHE_MAGIC;
+    header.version = MESH_CACHE_VERSION;
+    header.sourceHash = sourceHash;
+    header.vertexCount = (std::uint32_t)data.vertices.size();
+    header.elementCount = (std::uint32_t)data.elements.size();
+    header.submeshCount = (std::uint32_t)data.submeshes.size();
+    header.bounds = data.bounds;
+    header.boundingSphere = data.boundingSphere;
+
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+    if(ec) return false;
+
+    // Another process (or thread) may be writing the same file, so each writer uses its own temporary file
+    std::ostringstream temporaryPath;
+    temporaryPath << path << ".tmp" << std::hex << (std::uintptr_t)&data;
+    {
+        std::ofstream file(temporaryPath.str(), std::ios::binary | std::ios::trunc);
+        if(!file) return false;
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(data.vertices.data()), data.vertices.size() * sizeof(Vertex));
+        file.write(reinterpret_cast<const char*>(data.elements.data()), data.elements.size() * sizeof(std::uint32_t));
+        file.write(reinterpret_cast<const char*>(data.submeshes.data()), data.submeshes.size() * sizeof(Submesh));
+        if(!file){
+            file.close();
+            std::filesystem::remove(temporaryPath.str(), ec);
+            return false;
+        }
+    }
+    std::filesystem::rename(temporaryPath.str(), path, ec);
+    if(ec){
+        std::filesystem::remove(temporaryPath.str(), ec);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "vertex.hpp"
+#include "bounds.hpp"
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace our {
+
+    // A range of the element array that was read from one shape of the source file
+    struct Submesh {
+        std::uint32_t firstElement;
+        std::uint32_t elementCount;
+    };
+
+    // The CPU side data of a mesh before it is uploaded to the GPU
+    struct MeshData {
+        std::vector<Vertex> vertices;
+        std::vector<std::uint32_t> elements;
+        std::vector<Submesh> submeshes;
+        AABB bounds;
+        BoundingSphere boundingSphere;
+
+        // Computes the bounding box of the vertices, then the sphere around its center which encloses all the vertices
+        void computeBounds();
+    };
+
+    // The cache files are raw copies of the vertex struct, so its layout is part of the file format
+    static_assert(sizeof(Vertex) == 36, "Changing the layout of Vertex requires bumping MESH_CACHE_VERSION");
+
+    #define MESH_CACHE_MAGIC 0x4853454Du // "MESH" in little endian
+    #define MESH_CACHE_VERSION 1u
+    // The default directory (relative to the working directory) where the cached meshes are written
+    #define MESH_CACHE_DIRECTORY "cache/meshes"
+
+    // A mesh cache file starts with this header, followed by the vertices, the elements and the submeshes (in that order)
+    struct MeshCacheHeader {
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::uint64_t sourceHash; // The hash of the content of the source file (see "hashBytes")
+        std::uint32_t vertexCount;
+        std::uint32_t elementCount;
+        std::uint32_t submeshCount;
+        std::uint32_t pad0;
+        AABB bounds;
+        BoundingSphere boundingSphere;
+    };
+
+    // A read-only view of a mesh cache file that is mapped into memory.
+    // The pointers are valid as long as this object is alive
+    class MappedMeshCache {
+        void* mapping = nullptr;
+        size_t mappingSize = 0;
+#ifdef _WIN32
+        void* fileHandle = nullptr;
+        void* mappingHandle = nullptr;
+#endif
+        void unmap();
+    public:
+        const MeshCacheHeader* header = nullptr;
+        const Vertex* vertices = nullptr;
+        const std::uint32_t* elements = nullptr;
+        const Submesh* submeshes = nullptr;
+
+        MappedMeshCache() = default;
+        ~MappedMeshCache() { unmap(); }
+
+        // Maps the given file and checks that it is a valid cache file made from a source whose hash is "sourceHash".
+        // Returns false (and leaves this object empty) if the file does not exist, is stale or is corrupted
+        bool open(const std::string& path, std::uint64_t sourceHash);
+
+        MappedMeshCache(const MappedMeshCache&) = delete;
+        MappedMeshCache& operator=(const MappedMeshCache&) = delete;
+    };
+
+    namespace mesh_cache {
+        // Returns the 64-bit FNV-1a hash of the given bytes
+        std::uint64_t hashBytes(const void* data, size_t size);
+        // Reads the whole file into "content". Returns false if the file can't be read
+        bool readFile(const std::string& path, std::string& content);
+        // Returns the path of the cache file of the given source file and content hash
+        // (e.g. "cache/meshes/monkey-0123456789abcdef.mesh")
+        std::string getCachePath(const std::string& sourcePath, std::uint64_t sourceHash, const std::string& directory = MESH_CACHE_DIRECTORY);
+        // Writes the mesh data into a cache file. The file is written under a temporary name then renamed
+        // so that a reader never sees a partially written file. Returns false if the file can't be written
+        bool write(const std::string& path, std::uint64_t sourceHash, const MeshData& data);
+    }
+
+}
@@ -4,20 +4,125 @@
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tinyobj/tiny_obj_loader.h>
 
+#include <algorithm>
 #include <iostream>
+#include <sstream>
 #include <vector>
-#include <unordered_map>
 
-our::Mesh* our::mesh_utils::loadOBJ(const std::string& filename) {
+namespace {
 
-    // The data that we will use to initialize our mesh
-    std::vector<our::Vertex> vertices;
-    std::vector<GLuint> elements;
+    // Maps the (position, normal, texture coordinate) index triples of the OBJ corners to the indices of the unique vertices.
+    // Two corners with the same triple always build the same vertex, so hashing 3 integers is enough to find the duplicates
+    // (instead of hashing and comparing the whole vertex).
+    // It is an open addressing table with linear probing where all the entries live in one array
+    class CornerIndexMap {
+        struct Entry {
+            int position, normal, texcoord; // "position" is -1 in the empty entries since a corner always has a position
+            GLuint vertex;
+        };
+        std::vector<Entry> entries;
+        size_t mask = 0, count = 0;
 
-    // Since the OBJ can have duplicated vertices, we make them unique using this map
-    // The key is the vertex, the value is its index in the vector "vertices".
-    // That index will be used to populate the "elements" vector.
-    std::unordered_map<our::Vertex, GLuint> vertex_map;
+        static size_t hash(int position, int normal, int texcoord) {
+            // Mix in the indices one at a time (multiplying by odd constants) then fold the high bits down since the table uses the low bits
+            std::uint64_t h = (std::uint64_t)(std::uint32_t)position * 0x9E3779B97F4A7C15ull;
+            h = (h ^ (std::uint32_t)normal) * 0xC2B2AE3D27D4EB4Full;
+            h = (h ^ (std::uint32_t)texcoord) * 0x165667B19E3779F9ull;
+            return (size_t)(h ^ (h >> 32));
+        }
+
+        void rehash(size_t capacity) {
+            std::vector<Entry> old = std::move(entries);
+            entries.assign(capacity, Entry{-1, -1, -1, 0});
+            mask = capacity - 1;
+            for(const auto& entry : old){
+                if(entry.position < 0) continue;
+                size_t slot = hash(entry.position, entry.normal, entry.texcoord) & mask;
+                while(entries[slot].position >= 0) slot = (slot + 1) & mask;
+                entries[slot] = entry;
+            }
+        }
+
+    public:
+        // Makes room for "expectedCount" triples without growing (the table is kept at most half full)
+        explicit CornerIndexMap(size_t expectedCount) {
+            size_t capacity = 16;
+            while(capacity < 2 * expectedCount) capacity *= 2;
+            rehash(capacity);
+        }
+
+        // Returns the vertex of the triple. If the triple is new, it is given the vertex "newVertex" and "inserted" is set to true
+        GLuint findOrInsert(int position, int normal, int texcoord, GLuint newVertex, bool& inserted) {
+            size_t slot = hash(position, normal, texcoord) & mask;
+            while(entries[slot].position >= 0){
+                const Entry& entry = entries[slot];
+                if(entry.position == position && entry.normal == normal && entry.texcoord == texcoord){
+                    inserted = false;
+                    return entry.vertex;
+                }
+                slot = (slot + 1) & mask;
+            }
+            entries[slot] = {position, normal, texcoord, newVertex};
+            inserted = true;
+            if(++count * 2 > entries.size()) rehash(entries.size() * 2);
+            return newVertex;
+        }
+    };
+
+}
+
+our::Mesh* our::mesh_utils::loadOBJ(const std::string& filename, bool useCache) {
+    OBJData objData;
+    if (!readOBJ(filename, objData, useCache)) return nullptr;
+    return createMesh(objData);
+}
+
+bool our::mesh_utils::readOBJ(const std::string& filename, OBJData& objData, bool useCache) {
+
+    // The cache file is keyed by the hash of the content, so we always read the source file
+    // (which is much cheaper than parsing it) to know whether the cache is still valid
+    std::string content;
+    if (!mesh_cache::readFile(filename, content)) {
+        std::cerr << "Failed to load obj file \"" << filename << "\" since it could not be read" << std::endl;
+        return false;
+    }
+    std::uint64_t hash = mesh_cache::hashBytes(content.data(), content.size());
+    std::string cachePath = mesh_cache::getCachePath(filename, hash);
+
+    if (useCache && objData.cache.open(cachePath, hash)) {
+        objData.cached = true;
+        return true;
+    }
+
+    objData.cached = false;
+    MeshData& data = objData.data;
+    if (!parseOBJ(content, filename, data)) return false;
+    data.computeBounds();
+    if (useCache && !mesh_cache::write(cachePath, hash, data)) {
+        std::cout << "WARN could not write the mesh cache file \"" << cachePath << "\"" << std::endl;
+    }
+    return true;
+}
+
+our::Mesh* our::mesh_utils::createMesh(const OBJData& objData) {
+    if (objData.cached) {
+        const MappedMeshCache& cache = objData.cache;
+        return new our::Mesh(cache.vertices, cache.header->vertexCount, cache.elements, cache.header->elementCount,
+                             cache.header->bounds, cache.header->boundingSphere);
+    }
+    const MeshData& data = objData.data;
+    return new our::Mesh(data.vertices.data(), data.vertices.size(), data.elements.data(), data.elements.size(),
+                         data.bounds, data.boundingSphere);
+}
+
+bool our::mesh_utils::parseOBJ(const std::string& content, const std::string& filename, MeshData& data) {
+
+    // The data that we will use to initialize our mesh
+    std::vector<our::Vertex>& vertices = data.vertices;
+    std::vector<GLuint>& elements = data.elements;
+    vertices.clear();
+    elements.clear();
+    data.submeshes.clear();
 
     // The data loaded by Tiny OBJ Loader
     tinyobj::attrib_t attrib;
@@ -25,63 +130,83 @@ our::Mesh* our::mesh_utils::loadOBJ(const std::string& filename) {
     std::vector<tinyobj::material_t> materials;
     std::string warn, err;
 
-    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filename.c_str())) {
+    // The materials are ignored, so we don't give the parser a material reader
+    std::istringstream stream(content);
+    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, &stream)) {
         std::cerr << "Failed to load obj file \"" << filename << "\" due to error: " << err << std::endl;
-        return nullptr;
+        return false;
     }
     if (!warn.empty()) {
         std::cout << "WARN while loading obj file \"" << filename << "\": " << warn << std::endl;
     }
 
+    // Every corner adds one element, while the number of unique vertices is usually close to the largest attribute count
+    size_t cornerCount = 0;
+    for (const auto &shape : shapes) cornerCount += shape.mesh.indices.size();
+    size_t expectedVertexCount = std::max({attrib.vertices.size() / 3, attrib.normals.size() / 3, attrib.texcoords.size() / 2});
+    expectedVertexCount = std::min(expectedVertexCount, cornerCount);
+    elements.reserve(cornerCount);
+    vertices.reserve(expectedVertexCount);
+
+    // Since the OBJ can have duplicated vertices, we make them unique using this map
+    // The key is the index triple of the corner, the value is the index of its vertex in the vector "vertices".
+    // That index will be used to populate the "elements" vector.
+    CornerIndexMap vertex_map(expectedVertexCount);
+
     // An obj file can have multiple shapes where each shape can have its own material
-    // Ideally, we would load each shape into a separate mesh or store the start and end of it in the element buffer to be able to draw each shape separately
-    // But we ignored this fact since we don't plan to use multiple materials in the examples
+    // We store the range of each shape in the element buffer as a submesh (which is kept in the cache files),
+    // but the mesh still draws all the shapes at once since we don't plan to use multiple materials in the examples
     for (const auto &shape : shapes) {
+        data.submeshes.push_back({static_cast<std::uint32_t>(elements.size()), static_cast<std::uint32_t>(shape.mesh.indices.size())});
         for (const auto &index : shape.mesh.indices) {
+            // See if we already stored the vertex of this corner
+            bool inserted;
+            auto vertex_index = vertex_map.findOrInsert(index.vertex_index, index.normal_index, index.texcoord_index,
+                                                        static_cast<GLuint>(vertices.size()), inserted);
+            elements.push_back(vertex_index);
+            if (!inserted) continue;
+
+            // If no, read the data for a new vertex from the "attrib" object
+            // The normal and the texture coordinates are optional in OBJ files (their index is -1 when they are missing)
             Vertex vertex = {};
 
-            // Read the data for a vertex from the "attrib" object
             vertex.position = {
                     attrib.vertices[3 * index.vertex_index + 0],
                     attrib.vertices[3 * index.vertex_index + 1],
                     attrib.vertices[3 * index.vertex_index + 2]
             };
 
-            vertex.normal = {
-                    attrib.normals[3 * index.normal_index + 0],
-                    attrib.normals[3 * index.normal_index + 1],
-                    attrib.normals[3 * index.normal_index + 2]
-            };
-
-            vertex.tex_coord = {
-                    attrib.texcoords[2 * index.texcoord_index + 0],
-                    attrib.texcoords[2 * index.texcoord_index + 1]
-            };
-
+            if (index.normal_index >= 0) {
+                vertex.normal = {
+                        attrib.normals[3 * index.normal_index + 0],
+                        attrib.normals[3 * index.normal_index + 1],
+                        attrib.normals[3 * index.normal_index + 2]
+                };
+            }
 
-            vertex.color = {
-                    attrib.colors[3 * index.vertex_index + 0] * 255,
-                    attrib.colors[3 * index.vertex_index + 1] * 255,
-                    attrib.colors[3 * index.vertex_index + 2] * 255,
-                    255
-            };
+            if (index.texcoord_index >= 0) {
+                vertex.tex_coord = {
+                        attrib.texcoords[2 * index.texcoord_index + 0],
+                        attrib.texcoords[2 * index.texcoord_index + 1]
+                };
+            }
 
-            // See if we already stored a similar vertex
-            auto it = vertex_map.find(vertex);
-            if (it == vertex_map.end()) {
-                // if no, add it to the vertices and record its index
-                auto new_vertex_index = static_cast<GLuint>(vertices.size());
-                vertex_map[vertex] = new_vertex_index;
-                elements.push_back(new_vertex_index);
-                vertices.push_back(vertex);
+            if (attrib.colors.size() >= attrib.vertices.size()) {
+                vertex.color = {
+                        attrib.colors[3 * index.vertex_index + 0] * 255,
+                        attrib.colors[3 * index.vertex_index + 1] * 255,
+                        attrib.colors[3 * index.vertex_index + 2] * 255,
+                        255
+                };
             } else {
-                // if yes, just add its index in the elements vector
-                elements.push_back(it->second);
+                vertex.color = {255, 255, 255, 255};
             }
+
+            vertices.push_back(vertex);
         }
     }
 
-    return new our::Mesh(vertices, elements);
+    return true;
 }
 
 // Create a sphere (the vertex order in the triangles are CCW from the outside)
@@ -120,4 +245,28 @@ our::Mesh* our::mesh_utils::sphere(const glm::ivec2& segments){
     }
 
     return new our::Mesh(vertices, elements);
-}
\ No newline at end of file
+}
+
+// Create a unit cube centered at the origin (the vertex order in the triangles are CCW from the outside)
+// Each face has its own 4 vertices so that the normals and the texture coordinates are per face
+our::Mesh* our::mesh_utils::cube(){
+    std::vector<our::Vertex> vertices;
+    std::vector<GLuint> elements;
+
+    // For each face, we pick its normal and two axes along the face such that cross(right, up) = normal
+    const glm::vec3 normals[6] = {{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}};
+    const glm::vec3 ups[6] = {{0, 1, 0}, {0, 1, 0}, {0, 0, -1}, {0, 0, 1}, {0, 1, 0}, {0, 1, 0}};
+    for(int face = 0; face < 6; face++){
+        glm::vec3 normal = normals[face], up = ups[face];
+        glm::vec3 right = glm::cross(up, normal);
+        GLuint start = static_cast<GLuint>(vertices.size());
+        for(int corner = 0; corner < 4; corner++){
+            glm::vec2 tex_coord = glm::vec2(corner == 1 || corner == 2, corner >= 2);
+            glm::vec3 position = 0.5f * (normal + (2.0f * tex_coord.x - 1.0f) * right + (2.0f * tex_coord.y - 1.0f) * up);
+            vertices.push_back({position, our::Color(255, 255, 255, 255), tex_coord, normal});
+        }
+        elements.insert(elements.end(), {start, start + 1, start + 2, start + 2, start + 3, start});
+    }
+
+    return new our::Mesh(vertices, elements);
+}
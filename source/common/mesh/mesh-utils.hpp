@@ -1,12 +1,32 @@
 #pragma once
 
 #include "mesh.hpp"
+#include "mesh-cache.hpp"
 #include <string>
 
 namespace our::mesh_utils {
+    // The CPU side result of reading an ".obj" file: either its mapped cache file or the data parsed from the ".obj" file
+    struct OBJData {
+        MappedMeshCache cache;
+        MeshData data;
+        bool cached = false;
+    };
+
     // Load an ".obj" file into the mesh
-    Mesh* loadOBJ(const std::string& filename);
+    // If "useCache" is true, the mesh is read from its binary cache file (see "mesh-cache.hpp") when the cache matches the content
+    // of the ".obj" file. Otherwise, the ".obj" file is parsed and the cache file is (re)written for the next load
+    Mesh* loadOBJ(const std::string& filename, bool useCache = true);
+    // Read an ".obj" file (or its cache file) into "objData" without calling OpenGL, so it can run on any thread.
+    // This is the part of "loadOBJ" before the upload. Returns false on failure
+    bool readOBJ(const std::string& filename, OBJData& objData, bool useCache = true);
+    // Create a mesh from the data read by "readOBJ" (it must be called on the thread of the OpenGL context)
+    Mesh* createMesh(const OBJData& objData);
+    // Parse the content of an ".obj" file into "data" (the filename is only used in the error messages). Returns false on failure
+    bool parseOBJ(const std::string& content, const std::string& filename, MeshData& data);
     // Create a sphere (the vertex order in the triangles are CCW from the outside)
     // Segments define the number of divisions on the both the latitude and the longitude
     Mesh* sphere(const glm::ivec2& segments);
+    // Create a unit cube centered at the origin (the vertex order in the triangles are CCW from the outside)
+    // Each face has its own 4 vertices so that the normals and the texture coordinates are per face
+    Mesh* cube();
 }
\ No newline at end of file
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <glad/gl.h>
+#include <glm/mat4x4.hpp>
 #include "vertex.hpp"
+#include "bounds.hpp"
 
 namespace our {
 
@@ -9,6 +11,8 @@ namespace our {
     #define ATTRIB_LOC_COLOR    1
     #define ATTRIB_LOC_TEXCOORD 2
     #define ATTRIB_LOC_NORMAL   3
+    // The per-instance object to world matrix (used by the instanced shaders) takes 4 locations (one per column): 4, 5, 6 and 7
+    #define ATTRIB_LOC_INSTANCE_TRANSFORM 4
 
     class Mesh {
         // Here, we store the object names of the 3 main components of a mesh:
@@ -17,16 +21,16 @@ namespace our {
         unsigned int VAO;
         // We need to remember the number of elements that will be drawn by glDrawElements 
         GLsizei elementCount;
-    public:
-
-        // The constructor takes two vectors:
-        // - vertices which contain the vertex data.
-        // - elements which contain the indices of the vertices out of which each rectangle will be constructed.
-        // The mesh class does not keep a these data on the RAM. Instead, it should create
-        // a vertex buffer to store the vertex data on the VRAM,
-        // an element buffer to store the element data on the VRAM,
-        // a vertex array object to define how to read the vertex & element buffer during rendering 
-        Mesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& elements)
+        // The buffer that holds the per-instance matrices for instanced draws. It is created on the first instanced draw
+        // and "instanceCapacity" is the number of matrices it can currently hold
+        GLuint instanceVBO = 0;
+        GLsizei instanceCapacity = 0;
+        // The bounding volumes of the vertices in the local space (used by the renderer for frustum culling)
+        AABB localBounds;
+        BoundingSphere localBoundingSphere;
+
+        // Creates the buffers and the vertex array. The bounding volumes are set by the public constructors
+        Mesh(const Vertex* vertices, size_t vertexCount, const unsigned int* elements, size_t elementCount)
         {
             //TODO: (Req 2) Write this function
             // remember to store the number of elements in "elementCount" since you will need it for drawing
@@ -39,12 +43,12 @@ namespace our {
             //Bind and set vertex array and buffer
             glBindVertexArray(VAO);
             glBindBuffer(GL_ARRAY_BUFFER, VBO);
-            glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+            glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(Vertex), vertices, GL_STATIC_DRAW);
 
             //Bind and set elements buffer
             glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-            glBufferData(GL_ELEMENT_ARRAY_BUFFER, elements.size() * sizeof(unsigned int), &elements[0], GL_STATIC_DRAW);
-            elementCount = (int)elements.size();
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, elementCount * sizeof(unsigned int), elements, GL_STATIC_DRAW);
+            this->elementCount = (GLsizei)elementCount;
 
             glEnableVertexAttribArray(0);
             glVertexAttribPointer(0, 3, GL_FLOAT, false, 0, (void*)0);
@@ -62,7 +66,53 @@ namespace our {
             glVertexAttribPointer(ATTRIB_LOC_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (void*)offsetof(Vertex, color));
             
             glBindVertexArray(0);
-            
+        }
+    public:
+
+        // The constructor takes two vectors:
+        // - vertices which contain the vertex data.
+        // - elements which contain the indices of the vertices out of which each rectangle will be constructed.
+        // The mesh class does not keep a these data on the RAM. Instead, it should create
+        // a vertex buffer to store the vertex data on the VRAM,
+        // an element buffer to store the element data on the VRAM,
+        // a vertex array object to define how to read the vertex & element buffer during rendering 
+        Mesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& elements)
+            : Mesh(vertices.data(), vertices.size(), elements.data(), elements.size())
+        {
+            // Compute the bounding box of the vertices, then the sphere around its center which encloses all the vertices
+            if(!vertices.empty()){
+                localBounds.min = localBounds.max = vertices[0].position;
+                for(const auto& vertex : vertices){
+                    localBounds.min = glm::min(localBounds.min, vertex.position);
+                    localBounds.max = glm::max(localBounds.max, vertex.position);
+                }
+                localBoundingSphere.center = localBounds.getCenter();
+                float radiusSquared = 0.0f;
+                for(const auto& vertex : vertices){
+                    glm::vec3 offset = vertex.position - localBoundingSphere.center;
+                    radiusSquared = glm::max(radiusSquared, glm::dot(offset, offset));
+                }
+                localBoundingSphere.radius = std::sqrt(radiusSquared);
+            }
+        }
+
+        // Creates the mesh from arrays whose bounding volumes are already known (e.g. the arrays of a mapped mesh cache file).
+        // The data is uploaded straight from the given pointers and is not read again after the constructor returns
+        Mesh(const Vertex* vertices, size_t vertexCount, const unsigned int* elements, size_t elementCount,
+             const AABB& bounds, const BoundingSphere& boundingSphere)
+            : Mesh(vertices, vertexCount, elements, elementCount)
+        {
+            localBounds = bounds;
+            localBoundingSphere = boundingSphere;
+        }
+
+        // Get the bounding volumes of the mesh in its local space
+        const AABB& getLocalBounds() const { return localBounds; }
+        const BoundingSphere& getLocalBoundingSphere() const { return localBoundingSphere; }
+
+        // Get the internal OpenGL name of the vertex array (useful to identify the mesh when sorting the draw calls)
+        GLuint getVertexArray() const {
+            return VAO;
         }
 
         // this function should render the mesh
@@ -74,12 +124,40 @@ namespace our {
                 glBindVertexArray(0);
         }
 
+        // This function renders "count" instances of the mesh where the object to world matrix of each instance is read from "matrices"
+        // The matrices are streamed into the instance buffer which is attached to the vertex array on the first call
+        void drawInstanced(const glm::mat4* matrices, GLsizei count)
+        {
+            glBindVertexArray(VAO);
+            if(instanceVBO == 0){
+                glGenBuffers(1, &instanceVBO);
+                glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+                // A mat4 attribute is read as 4 vec4 attributes, and each of them advances once per instance
+                for(GLuint column = 0; column < 4; column++){
+                    GLuint location = ATTRIB_LOC_INSTANCE_TRANSFORM + column;
+                    glEnableVertexAttribArray(location);
+                    glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(column * sizeof(glm::vec4)));
+                    glVertexAttribDivisor(location, 1);
+                }
+            } else {
+                glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+            }
+            // The buffer grows to the largest batch seen so far. Otherwise, we orphan the old storage so that
+            // the driver does not wait for the previous draw calls that still read from it
+            if(count > instanceCapacity) instanceCapacity = count;
+            glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(glm::mat4), nullptr, GL_STREAM_DRAW);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(glm::mat4), matrices);
+            glDrawElementsInstanced(GL_TRIANGLES, elementCount, GL_UNSIGNED_INT, 0, count);
+            glBindVertexArray(0);
+        }
+
         // this function should delete the vertex & element buffers and the vertex array object
         ~Mesh(){
             //TODO: (Req 2) Write this function
             glDeleteVertexArrays(1, &VAO);
             glDeleteBuffers(1, &EBO);
             glDeleteBuffers(1, &VBO);
+            if(instanceVBO) glDeleteBuffers(1, &instanceVBO);
         }
 
         Mesh(Mesh const &) = delete;
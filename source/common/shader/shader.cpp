@@ -1,4 +1,6 @@
 #include "shader.hpp"
+#include "uniform-buffer.hpp"
+#include "../texture/texture-buffer.hpp"
 
 #include <cassert>
 #include <iostream>
@@ -48,7 +50,7 @@ bool our::ShaderProgram::attach(const std::string &filename, GLenum type) const
 
 
 
-bool our::ShaderProgram::link() const {
+bool our::ShaderProgram::link() {
     //TODO: Complete this function
     //Note: The function "checkForLinkingErrors" checks if there is
     // an error in the given program. You should use it to check if there is a
@@ -63,6 +65,53 @@ bool our::ShaderProgram::link() const {
         return false;
     }
 
+    // Now we enumerate all the active uniforms once and store their locations,
+    // so that setting a uniform never needs to call glGetUniformLocation
+    uniformLocations.clear();
+    handleLocations.clear();
+    GLint uniformCount = 0, maxNameLength = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniformCount);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+    std::string name(maxNameLength, '\0');
+    for(GLint index = 0; index < uniformCount; index++){
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type;
+        glGetActiveUniform(program, (GLuint)index, maxNameLength, &length, &size, &type, name.data());
+        std::string uniformName = name.substr(0, length);
+        GLint location = glGetUniformLocation(program, uniformName.c_str());
+        // Uniforms inside uniform blocks have no location so we skip them
+        if(location < 0) continue;
+        uniformLocations[uniformName] = location;
+        // The shared samplers (e.g. the light buffers) always read from their fixed texture units
+        if(GLint unit = getSharedTextureUnit(uniformName); unit >= 0){
+            glUseProgram(program);
+            glUniform1i(location, unit);
+        }
+        // Arrays of basic types are reported once as "name[0]", so we register the plain name and every element
+        if(size > 1 || uniformName.back() == ']'){
+            std::string baseName = uniformName.substr(0, uniformName.rfind('['));
+            uniformLocations[baseName] = location;
+            for(GLint element = 1; element < size; element++){
+                std::string elementName = baseName + "[" + std::to_string(element) + "]";
+                uniformLocations[elementName] = glGetUniformLocation(program, elementName.c_str());
+            }
+        }
+    }
+
+    // Finally, we bind every shared uniform block to its fixed binding point
+    // so that the buffers bound by the renderer are visible to this program
+    GLint blockCount = 0, maxBlockNameLength = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &blockCount);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxBlockNameLength);
+    std::string blockName(maxBlockNameLength, '\0');
+    for(GLint index = 0; index < blockCount; index++){
+        GLsizei length = 0;
+        glGetActiveUniformBlockName(program, (GLuint)index, maxBlockNameLength, &length, blockName.data());
+        if(GLint binding = getUniformBlockBinding(blockName.substr(0, length)); binding >= 0)
+            glUniformBlockBinding(program, (GLuint)index, (GLuint)binding);
+    }
+
     return true;
 }
 
@@ -2,6 +2,8 @@
 #define SHADER_HPP
 
 #include <string>
+#include <vector>
+#include <unordered_map>
 
 #include <glad/gl.h>
 #include <glm/glm.hpp>
@@ -9,11 +11,50 @@
 
 namespace our {
 
+    // A uniform handle is a uniform name that was registered once in a global name table.
+    // Every shader program can resolve a handle to its own uniform location by indexing an array (no hashing or string building)
+    // so handles should be created once (e.g. as static variables) and used in the hot paths instead of strings.
+    class UniformHandle {
+        GLuint id; // The index of the uniform name in the global name table
+
+        // The global name table. We use function-local statics so that handles can be safely created during static initialization
+        static std::unordered_map<std::string, GLuint>& registry() {
+            static std::unordered_map<std::string, GLuint> ids;
+            return ids;
+        }
+    public:
+        static std::vector<std::string>& names() {
+            static std::vector<std::string> names;
+            return names;
+        }
+
+        // Registers the name (if it was not registered before) and stores its index
+        explicit UniformHandle(const std::string& name) {
+            auto& ids = registry();
+            if(auto it = ids.find(name); it != ids.end()){
+                id = it->second;
+            } else {
+                id = (GLuint)names().size();
+                ids[name] = id;
+                names().push_back(name);
+            }
+        }
+
+        GLuint getID() const { return id; }
+        const std::string& getName() const { return names()[id]; }
+    };
+
     class ShaderProgram {
 
     private:
         //Shader Program Handle (OpenGL object name)
         GLuint program;
+        // The locations of all the active uniforms, filled once by "link" so that we never query OpenGL while rendering
+        std::unordered_map<std::string, GLint> uniformLocations;
+        // The locations of the uniform handles (indexed by the handle id). They are resolved lazily from "uniformLocations"
+        std::vector<GLint> handleLocations;
+        // A value stored in "handleLocations" for handles that has not been resolved yet
+        static constexpr GLint UNRESOLVED_LOCATION = -2;
 
     public:
         ShaderProgram(){
@@ -27,15 +68,32 @@ namespace our {
 
         bool attach(const std::string &filename, GLenum type) const;
 
-        bool link() const;
+        // Links the program then enumerates its active uniforms into the location table
+        bool link();
 
-        void use() { 
+        void use() {
             glUseProgram(program);
         }
 
-        GLuint getUniformLocation(const std::string &name) {
+        // Get the internal OpenGL name of the program
+        GLuint getOpenGLName() const {
+            return program;
+        }
+
+        GLint getUniformLocation(const std::string &name) const {
             //TODO: (Req 1) Return the location of the uniform with the given name
-            return glGetUniformLocation(program, name.c_str());
+            // Inactive uniforms are not in the table and (like glGetUniformLocation) we return -1 for them
+            if(auto it = uniformLocations.find(name); it != uniformLocations.end())
+                return it->second;
+            return -1;
+        }
+
+        GLint getUniformLocation(UniformHandle handle) {
+            GLuint id = handle.getID();
+            if(id >= handleLocations.size()) handleLocations.resize(UniformHandle::names().size(), UNRESOLVED_LOCATION);
+            GLint& location = handleLocations[id];
+            if(location == UNRESOLVED_LOCATION) location = getUniformLocation(handle.getName());
+            return location;
         }
 
         void set(const std::string &uniform, GLfloat value) {
@@ -73,7 +131,36 @@ namespace our {
             //(Uniform location, number of matrices, transpose, pointer to the beginning of matrix)
             glUniformMatrix4fv(getUniformLocation(uniform), 1, GL_FALSE, &matrix[0][0]);
         }
-        //void set(const)
+
+        // The following overloads do the same as the ones above but they use a uniform handle instead of a name.
+        // If the uniform is not active in this program, no OpenGL call is issued.
+        void set(UniformHandle uniform, GLfloat value) {
+            if(GLint location = getUniformLocation(uniform); location >= 0) glUniform1f(location, value);
+        }
+
+        void set(UniformHandle uniform, GLuint value) {
+            if(GLint location = getUniformLocation(uniform); location >= 0) glUniform1ui(location, value);
+        }
+
+        void set(UniformHandle uniform, GLint value) {
+            if(GLint location = getUniformLocation(uniform); location >= 0) glUniform1i(location, value);
+        }
+
+        void set(UniformHandle uniform, glm::vec2 value) {
+            if(GLint location = getUniformLocation(uniform); location >= 0) glUniform2f(location, value.x, value.y);
+        }
+
+        void set(UniformHandle uniform, glm::vec3 value) {
+            if(GLint location = getUniformLocation(uniform); location >= 0) glUniform3f(location, value.x, value.y, value.z);
+        }
+
+        void set(UniformHandle uniform, glm::vec4 value) {
+            if(GLint location = getUniformLocation(uniform); location >= 0) glUniform4f(location, value.x, value.y, value.z, value.w);
+        }
+
+        void set(UniformHandle uniform, const glm::mat4& matrix) {
+            if(GLint location = getUniformLocation(uniform); location >= 0) glUniformMatrix4fv(location, 1, GL_FALSE, &matrix[0][0]);
+        }
 
         //TODO: (Req 1) Delete the copy constructor and assignment operator.
         ShaderProgram(const ShaderProgram&) = delete;
@@ -83,4 +170,4 @@ namespace our {
 
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <string>
+
+#include <glad/gl.h>
+
+namespace our {
+
+    // The binding points of the uniform blocks that are shared between all the shader programs.
+    // Since GLSL 3.3 does not support "layout(binding = ...)", every program binds its blocks to these points when it is linked
+    #define UNIFORM_BLOCK_BINDING_FRAME  1
+
+    // Returns the binding point of the shared uniform block with the given name, or -1 if the block is not a shared one
+    inline GLint getUniformBlockBinding(const std::string& blockName) {
+        if(blockName == "FrameConstants") return UNIFORM_BLOCK_BINDING_FRAME;
+        return -1;
+    }
+
+    // This class defines an OpenGL uniform buffer which stores the data of a uniform block
+    // so that it can be uploaded once and shared by every shader program that declares the block
+    class UniformBuffer {
+        // The OpenGL object name of this buffer
+        GLuint name;
+        // The size of the buffer storage in bytes
+        GLsizeiptr size = 0;
+    public:
+        // This constructor creates an OpenGL buffer and saves its object name in the member variable "name"
+        UniformBuffer() {
+            glGenBuffers(1, &name);
+        }
+
+        // This deconstructor deletes the underlying OpenGL buffer
+        ~UniformBuffer() {
+            glDeleteBuffers(1, &name);
+        }
+
+        // Allocates (or reallocates) the buffer storage to the given size in bytes. The content is left undefined
+        void allocate(GLsizeiptr size) {
+            this->size = size;
+            glBindBuffer(GL_UNIFORM_BUFFER, name);
+            glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        }
+
+        // Replaces the first "dataSize" bytes of the buffer with the given data.
+        // The old storage is orphaned first so that we don't wait for draw calls that still read the previous content
+        void update(const void* data, GLsizeiptr dataSize) {
+            glBindBuffer(GL_UNIFORM_BUFFER, name);
+            glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+            if(dataSize > 0) glBufferSubData(GL_UNIFORM_BUFFER, 0, dataSize, data);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        }
+
+        // Binds this buffer to the given uniform block binding point
+        void bind(GLuint bindingPoint) const {
+            glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, name);
+        }
+
+        GLsizeiptr getSize() const { return size; }
+
+        UniformBuffer(const UniformBuffer&) = delete;
+        UniformBuffer& operator=(const UniformBuffer&) = delete;
+    };
+
+}
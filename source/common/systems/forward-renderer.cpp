@@ -2,13 +2,121 @@
 #include "../mesh/mesh-utils.hpp"
 #include "../texture/texture-utils.hpp"
 
+#include <GLFW/glfw3.h>
+#include <cstring>
+
 namespace our
 {
 
+    // The handles of the uniforms sent by the renderer (created once so that no strings are built while rendering)
+    namespace uniforms
+    {
+        const UniformHandle TRANSFORM("transform");
+        const UniformHandle OBJECT_TO_WORLD("objectToWorld");
+        const UniformHandle OBJECT_TO_INV_TRANSPOSE("objectToInvTranspose");
+        const UniformHandle OIT_ACCUMULATION("accumulation");
+        const UniformHandle OIT_WEIGHTS("weights");
+    }
+
+    // Sends the uniforms that differ from one object to the other (everything else is in the "FrameConstants" block).
+    // Shaders that use the frame constants only need "objectToWorld" and "objectToInvTranspose",
+    // while the unlit shaders (which are also used outside the renderer) still receive the full "transform"
+    static void sendObjectUniforms(ShaderProgram *shader, const RenderCommand &command, const glm::mat4 &VP)
+    {
+        if (shader->getUniformLocation(uniforms::TRANSFORM) >= 0)
+            shader->set(uniforms::TRANSFORM, VP * command.localToWorld);
+        // pass mat4 that transforms local space to world space to calculate world vector
+        shader->set(uniforms::OBJECT_TO_WORLD, command.localToWorld);
+        // mat4 that represents the object to world inverse transpose for the normal
+        if (shader->getUniformLocation(uniforms::OBJECT_TO_INV_TRANSPOSE) >= 0)
+            shader->set(uniforms::OBJECT_TO_INV_TRANSPOSE, glm::transpose(glm::inverse(command.localToWorld)));
+    }
+
+    // Computes the key used to order the opaque commands. From the most to the least significant bits, the key contains:
+    // the pipeline state bits (8 bits), the shader (12 bits), the material (14 bits), the mesh (14 bits) and the depth (16 bits).
+    // So the commands are grouped by state first to minimize the state changes, then drawn front-to-back to reduce overdraw.
+    // Only the low bits of each id are used, so two objects could share a group by accident but this only affects the order.
+    static std::uint64_t computeOpaqueSortKey(const RenderCommand &command, const glm::vec3 &cameraPosition, const glm::vec3 &cameraForward, float far)
+    {
+        float depth = glm::clamp(glm::dot(command.center - cameraPosition, cameraForward) / far, 0.0f, 1.0f);
+        std::uint64_t key = command.material->pipelineState.getSortBits();
+        key = (key << 12) | (command.material->shader->getOpenGLName() & 0xFFF);
+        key = (key << 14) | (command.material->getID() & 0x3FFF);
+        key = (key << 14) | (command.mesh->getVertexArray() & 0x3FFF);
+        key = (key << 16) | (std::uint64_t)(depth * 0xFFFF);
+        return key;
+    }
+
+    // Computes the key used to order the transparent commands back-to-front (so sorting the keys in ascending order
+    // draws the farthest command first). The depth is the distance of the command's center along the camera forward direction.
+    // The bits of a float can be compared as an unsigned integer after flipping all the bits of the negative values
+    // and only the sign bit of the positive ones. Then all the bits are flipped to turn the ascending order into a descending one.
+    static std::uint32_t computeTransparentSortKey(const RenderCommand &command, const glm::vec3 &cameraPosition, const glm::vec3 &cameraForward)
+    {
+        float depth = glm::dot(command.center - cameraPosition, cameraForward);
+        std::uint32_t bits;
+        std::memcpy(&bits, &depth, sizeof(bits));
+        bits = (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+        return ~bits;
+    }
+
+    // Returns false if the mesh of the command is completely outside the view frustum.
+    // The cheap bounding sphere test is done first, then the world space bounding box is tested if the sphere is visible
+    static bool isVisible(const RenderCommand &command, const Frustum &frustum)
+    {
+        if (!frustum.intersects(command.mesh->getLocalBoundingSphere().transformed(command.localToWorld)))
+            return false;
+        return frustum.intersects(command.mesh->getLocalBounds().transformed(command.localToWorld));
+    }
+
+    // Builds the commands of the mesh renderers in the given query slice, rejects the ones outside the frustum
+    // and splits the rest into the opaque and the transparent commands of the given buffer (see "RenderCommandBuffer").
+    // It only reads the world so different slices can be gathered at the same time into different buffers
+    static void gatherCommands(const Query<MeshRendererComponent, Entity> &meshRenderers, const Frustum &frustum, RenderCommandBuffer &buffer)
+    {
+        buffer.commands.resize(buffer.commands.getCapacity());
+        buffer.opaqueCount = buffer.transparentCount = buffer.culledCount = 0;
+        // For each entity that has a mesh renderer component
+        for (auto [meshRenderer, entity] : meshRenderers)
+        {
+            // We construct a command from it
+            RenderCommand command;
+            command.localToWorld = entity->getCachedLocalToWorldMatrix();
+            command.center = glm::vec3(command.localToWorld * glm::vec4(0, 0, 0, 1));
+            command.mesh = meshRenderer->mesh;
+            command.material = meshRenderer->material;
+            // Reject the commands that are outside the camera view before sorting and drawing them
+            if (!isVisible(command, frustum))
+            {
+                buffer.culledCount++;
+                continue;
+            }
+            // if it is transparent, we add it to the transparent commands list
+            if (command.material->transparent)
+            {
+                buffer.commands[buffer.commands.size() - 1 - buffer.transparentCount++] = command;
+            }
+            else
+            {
+                // Otherwise, we add it to the opaque command list
+                buffer.commands[buffer.opaqueCount++] = command;
+            }
+        }
+    }
+
     void ForwardRenderer::initialize(glm::ivec2 windowSize, const nlohmann::json &config)
     {
         // First, we store the window size for later use
         this->windowSize = windowSize;
+        // The cached OpenGL state may be stale if the state was changed outside of the cache before this renderer was created
+        GLStateCache::invalidate();
+
+        // Create the texture buffer that holds the lights of the scene and the light clusters (uploaded once per frame)
+        lightsBuffer = new TextureBuffer(GL_RGBA32F);
+        lightClusters.initialize(windowSize);
+        // and the uniform buffer that holds the per-frame constants
+        frameConstantsBuffer = new UniformBuffer();
+        frameConstantsBuffer->allocate(sizeof(FrameConstants));
 
         // Then we check if there is a sky texture in the configuration
         if (config.contains("sky"))
@@ -54,8 +162,15 @@ namespace our
             this->skyMaterial->transparent = false;
         }
 
-        // Then we check if there is a postprocessing shader in the configuration
-        if (config.contains("postprocess"))
+        // Then we check which transparency mode is selected (the sorted mode is the default)
+        transparencyMode = config.value<std::string>("transparency", "sorted") == "weighted-blended"
+                               ? TransparencyMode::WEIGHTED_BLENDED
+                               : TransparencyMode::SORTED;
+
+        // The scene is drawn offscreen if there is a postprocessing shader in the configuration
+        // or if the order independent transparency is used (since it needs to test against the depth of the opaque objects)
+        offscreen = config.contains("postprocess") || transparencyMode == TransparencyMode::WEIGHTED_BLENDED;
+        if (offscreen)
         {
             // TODO: (Req 11) Create a framebuffer
             glGenFramebuffers(1, &postprocessFrameBuffer);
@@ -76,6 +191,11 @@ namespace our
 
             // Create a vertex array to use for drawing the texture
             glGenVertexArrays(1, &postProcessVertexArray);
+        }
+
+        postprocessMaterial = nullptr;
+        if (config.contains("postprocess"))
+        {
 
             // Create a sampler to use for sampling the scene texture in the post processing shader
             Sampler *postprocessSampler = new Sampler();
@@ -99,10 +219,62 @@ namespace our
             // so it is more performant to disable the depth mask
             postprocessMaterial->pipelineState.depthMask = false;
         }
+
+        if (transparencyMode == TransparencyMode::WEIGHTED_BLENDED)
+        {
+            // The transparent objects are drawn to their own color targets but they share the depth of the scene
+            glGenFramebuffers(1, &oitFrameBuffer);
+            glBindFramebuffer(GL_FRAMEBUFFER, oitFrameBuffer);
+            oitAccumulationTarget = texture_utils::empty(GL_RGBA16F, windowSize, GL_RGBA, GL_HALF_FLOAT);
+            oitWeightTarget = texture_utils::empty(GL_R16F, windowSize, GL_RED, GL_HALF_FLOAT);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, oitAccumulationTarget->getOpenGLName(), 0);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, oitWeightTarget->getOpenGLName(), 0);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTarget->getOpenGLName(), 0);
+            GLenum drawBuffers[] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+            glDrawBuffers(2, drawBuffers);
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+            // The composite shader draws the average transparent color over the scene
+            oitCompositeShader = new ShaderProgram();
+            oitCompositeShader->attach("assets/shaders/fullscreen.vert", GL_VERTEX_SHADER);
+            oitCompositeShader->attach("assets/shaders/oit_composite.frag", GL_FRAGMENT_SHADER);
+            oitCompositeShader->link();
+        }
+
+        // The depth pre-pass needs its own depth-only shaders (one for each way the material shaders compute the position)
+        depthPrepass = config.value("depthPrepass", false);
+        if (depthPrepass)
+        {
+            depthShader = new ShaderProgram();
+            depthShader->attach("assets/shaders/depth.vert", GL_VERTEX_SHADER);
+            depthShader->attach("assets/shaders/depth.frag", GL_FRAGMENT_SHADER);
+            depthShader->link();
+
+            depthTransformShader = new ShaderProgram();
+            depthTransformShader->attach("assets/shaders/depth_transform.vert", GL_VERTEX_SHADER);
+            depthTransformShader->attach("assets/shaders/depth.frag", GL_FRAGMENT_SHADER);
+            depthTransformShader->link();
+
+            depthInstancedShader = new ShaderProgram();
+            depthInstancedShader->attach("assets/shaders/depth_instanced.vert", GL_VERTEX_SHADER);
+            depthInstancedShader->attach("assets/shaders/depth.frag", GL_FRAGMENT_SHADER);
+            depthInstancedShader->link();
+        }
+
+        // Create the queries that measure the opaque pass
+        glGenQueries(2, opaqueSamplesQueries);
+        glGenQueries(2, opaqueTimeQueries);
+        renderedFrameCount = 0;
     }
 
     void ForwardRenderer::destroy()
     {
+        // Delete the light and uniform buffers
+        delete lightsBuffer;
+        lightsBuffer = nullptr;
+        lightClusters.destroy();
+        delete frameConstantsBuffer;
+        frameConstantsBuffer = nullptr;
         // Delete all objects related to the sky
         if (skyMaterial)
         {
@@ -114,56 +286,172 @@ namespace our
         }
         // Delete all objects related to post processing
         if (postprocessMaterial)
+        {
+            delete postprocessMaterial->sampler;
+            delete postprocessMaterial->shader;
+            delete postprocessMaterial;
+            postprocessMaterial = nullptr;
+        }
+        if (offscreen)
         {
             glDeleteFramebuffers(1, &postprocessFrameBuffer);
             glDeleteVertexArrays(1, &postProcessVertexArray);
             delete colorTarget;
             delete depthTarget;
-            delete postprocessMaterial->sampler;
-            delete postprocessMaterial->shader;
-            delete postprocessMaterial;
+            offscreen = false;
+        }
+        // Delete all objects related to the order independent transparency
+        if (oitFrameBuffer)
+        {
+            glDeleteFramebuffers(1, &oitFrameBuffer);
+            oitFrameBuffer = 0;
+            delete oitAccumulationTarget;
+            delete oitWeightTarget;
+            delete oitCompositeShader;
+            oitAccumulationTarget = oitWeightTarget = nullptr;
+            oitCompositeShader = nullptr;
+        }
+        // Delete the depth pre-pass shaders
+        if (depthPrepass)
+        {
+            delete depthShader;
+            delete depthTransformShader;
+            delete depthInstancedShader;
+            depthShader = depthTransformShader = depthInstancedShader = nullptr;
+            depthPrepass = false;
+        }
+        // Delete the queries
+        if (opaqueSamplesQueries[0])
+        {
+            glDeleteQueries(2, opaqueSamplesQueries);
+            glDeleteQueries(2, opaqueTimeQueries);
+            opaqueSamplesQueries[0] = opaqueSamplesQueries[1] = 0;
+            opaqueTimeQueries[0] = opaqueTimeQueries[1] = 0;
         }
     }
 
-    void ForwardRenderer::render(World *world)
+    bool ForwardRenderer::usesDepthPrepass(const Material *material) const
     {
-        // First of all, we search for a camera and for all the mesh renderers
-        CameraComponent *camera = nullptr;
-        opaqueCommands.clear();
-        transparentCommands.clear();
-        //TODO: (Light) clear the list of lights
-        lights.clear();
-        for (auto entity : world->getEntities())
+        // The materials that don't test or write the depth gain nothing from the pre-pass.
+        // The alpha tested materials are drawn only in the color pass, otherwise their cut-out texels would write depth
+        // in the pre-pass then be discarded in the color pass (leaving holes that hide the objects behind them)
+        return depthPrepass && material->pipelineState.depthTesting.enabled && material->pipelineState.depthMask &&
+               !material->isAlphaTested();
+    }
+
+    void ForwardRenderer::drawOpaqueCommands(const glm::mat4 &VP, bool depthOnly)
+    {
+        // The commands are drawn in the order of their sort keys, so consecutive commands usually share the same material.
+        // In that case, we skip the material setup since the pipeline state, program and textures are already in place.
+        // Consecutive commands that share the same mesh and material are drawn together with a single instanced draw call
+        // if the material has an instanced shader.
+        // Both passes split the commands into the same batches, so every fragment gets the same depth in both passes.
+        Material *lastMaterial = nullptr;
+        bool lastInstanced = false;
+        ShaderProgram *shader = nullptr;
+        for (size_t i = 0; i < opaqueOrder.size();)
         {
-            // If we hadn't found a camera yet, we look for a camera in this entity
-            if (!camera)
-                camera = entity->getComponent<CameraComponent>();
-            // If this entity has a mesh renderer component
-            if (auto meshRenderer = entity->getComponent<MeshRendererComponent>(); meshRenderer)
+            RenderCommand &command = opaqueCommands[opaqueOrder[i].index];
+            // Find the end of the run of commands that can be drawn together
+            size_t end = i + 1;
+            if (command.material->supportsInstancing())
+            {
+                while (end < opaqueOrder.size())
+                {
+                    const RenderCommand &next = opaqueCommands[opaqueOrder[end].index];
+                    if (next.mesh != command.mesh || next.material != command.material)
+                        break;
+                    end++;
+                }
+            }
+            bool instanced = end - i >= MIN_INSTANCED_BATCH_SIZE;
+            bool prepassed = usesDepthPrepass(command.material);
+            if (depthOnly && !prepassed)
+            {
+                i = end;
+                continue;
+            }
+
+            if (command.material != lastMaterial || instanced != lastInstanced)
             {
-                // We construct a command from it
-                RenderCommand command;
-                command.localToWorld = meshRenderer->getOwner()->getLocalToWorldMatrix();
-                command.center = glm::vec3(command.localToWorld * glm::vec4(0, 0, 0, 1));
-                command.mesh = meshRenderer->mesh;
-                command.material = meshRenderer->material;
-                // if it is transparent, we add it to the transparent commands list
-                if (command.material->transparent)
+                if (depthOnly)
                 {
-                    transparentCommands.push_back(command);
+                    // Only the depth is written, but the face culling and the depth function of the material are kept
+                    // so that the same fragments pass in both passes
+                    PipelineState depthState = command.material->pipelineState;
+                    depthState.blending.enabled = false;
+                    depthState.colorMask = glm::bvec4(false);
+                    depthState.setup();
+                    if (instanced)
+                        shader = depthInstancedShader;
+                    else if (command.material->shader->getUniformLocation(uniforms::TRANSFORM) >= 0)
+                        shader = depthTransformShader;
+                    else
+                        shader = depthShader;
+                    shader->use();
                 }
                 else
                 {
-                    // Otherwise, we add it to the opaque command list
-                    opaqueCommands.push_back(command);
+                    command.material->setup(instanced ? ShaderVariant::INSTANCED : ShaderVariant::DEFAULT);
+                    shader = command.material->shader;
+                    // The depth buffer already holds the nearest depth so only the visible fragments are shaded
+                    if (prepassed)
+                    {
+                        GLStateCache::depthFunc(GL_EQUAL);
+                        GLStateCache::depthMask(false);
+                    }
                 }
+                lastMaterial = command.material;
+                lastInstanced = instanced;
             }
-            //TODO: (Light) push light components into the list of lights
-            // fill the vector of lights with the light components to be used in the shaders
-            if (auto light = entity->getComponent<LightComponent>(); light)
+
+            if (instanced)
             {
-                lights.push_back(light);
+                // The instanced shaders read the object to world matrix from a per-instance attribute
+                instanceMatrices.clear();
+                for (size_t j = i; j < end; j++)
+                    instanceMatrices.push_back(opaqueCommands[opaqueOrder[j].index].localToWorld);
+                command.mesh->drawInstanced(instanceMatrices.data(), (GLsizei)instanceMatrices.size());
             }
+            else
+            {
+                //TODO: (Light) SEND THE NEEDED TRANSFORMS TO THE SHADER FOR LIGHTING SUPPORT
+                // the camera data and the lights are already in the uniform buffers, so we only send the object transforms
+                sendObjectUniforms(shader, command, VP);
+                command.mesh->draw();
+            }
+            i = end;
+        }
+    }
+
+    void ForwardRenderer::render(World *world, ThreadPool *pool)
+    {
+        // The state cache counters (state calls and texture/sampler binds) are reported per frame
+        GLStateCache::resetStatistics();
+        // Free the per-frame arrays of the previous frame at once
+        frameAllocator.reset();
+        statistics.frameBytes = frameAllocator.getLastFrameBytes();
+        statistics.peakFrameBytes = frameAllocator.getPeakFrameBytes();
+
+        // Update the world matrices of all the entities once (parents before children) before reading them
+        world->updateTransforms(pool);
+
+        // First of all, we search for a camera
+        CameraComponent *camera = nullptr;
+        //TODO: (Light) clear the list of lights
+        auto lightComponents = world->query<LightComponent>();
+        lights = frameAllocator.allocateArray<LightComponent *>(lightComponents.getCandidateCount());
+        // We use the first camera in the world
+        for (auto [cameraComponent] : world->query<CameraComponent>())
+        {
+            camera = cameraComponent;
+            break;
+        }
+        //TODO: (Light) push light components into the list of lights
+        // fill the vector of lights with the light components to be used in the shaders
+        for (auto [light] : lightComponents)
+        {
+            lights.push_back(light);
         }
 
         // If there is no camera, we return (we cannot render without a camera)
@@ -174,15 +462,157 @@ namespace our
         // HINT: See how you wrote the CameraComponent::getViewMatrix, it should help you solve this one
         // glm::vec3 cameraForward = glm::vec3(0.0, 0.0, -1.0f);
         glm::mat4 VM = camera->getViewMatrix();
-        glm::vec3 cameraForward = glm::vec3(VM[2][0], VM[2][1], VM[2][2]); // 3rd row
-        std::sort(transparentCommands.begin(), transparentCommands.end(), [cameraForward](const RenderCommand &first, const RenderCommand &second)
-                  {
-            //TODO: (Req 9) Finish this function
-            // HINT: the following return should return true "first" should be drawn before "second". 
-            return first.center.z < second.center.z; });
 
         // TODO: (Req 9) Get the camera ViewProjection matrix and store it in VP
-        glm::mat4 VP = camera->getProjectionMatrix(windowSize) * camera->getViewMatrix();
+        glm::mat4 projection = camera->getProjectionMatrix(windowSize);
+        glm::mat4 VP = projection * VM;
+        Frustum frustum = Frustum::fromMatrix(VP);
+
+        // Then we gather the commands of all the mesh renderers. The mesh renderers are split into chunks and each chunk
+        // is gathered (and culled) into its own buffer, in parallel if there is a thread pool.
+        // The buffers are merged in the chunk order so the result is the same as gathering everything on one thread.
+        auto meshRenderers = world->query<MeshRendererComponent, Entity>();
+        size_t candidateCount = meshRenderers.getCandidateCount();
+        size_t chunkSize = pool ? pool->getChunkSize(candidateCount, MIN_COMMANDS_PER_JOB) : std::max<size_t>(candidateCount, 1);
+        size_t chunkCount = (candidateCount + chunkSize - 1) / chunkSize;
+        commandBuffers = frameAllocator.allocateArray<RenderCommandBuffer>(chunkCount);
+        commandBuffers.resize(chunkCount);
+        for (size_t chunk = 0; chunk < chunkCount; chunk++)
+        {
+            size_t chunkBegin = chunk * chunkSize;
+            commandBuffers[chunk] = RenderCommandBuffer();
+            commandBuffers[chunk].commands = frameAllocator.allocateArray<RenderCommand>(std::min(chunkSize, candidateCount - chunkBegin));
+        }
+        auto gatherChunk = [&](size_t begin, size_t end)
+        {
+            gatherCommands(meshRenderers.slice(begin, end), frustum, commandBuffers[begin / chunkSize]);
+        };
+        if (pool)
+            pool->parallelFor(candidateCount, MIN_COMMANDS_PER_JOB, gatherChunk);
+        else if (candidateCount > 0)
+            gatherChunk(0, candidateCount);
+
+        size_t opaqueCount = 0, transparentCount = 0;
+        statistics.culledCount = 0;
+        for (const RenderCommandBuffer &buffer : commandBuffers)
+        {
+            opaqueCount += buffer.opaqueCount;
+            transparentCount += buffer.transparentCount;
+            statistics.culledCount += buffer.culledCount;
+        }
+        opaqueCommands = frameAllocator.allocateArray<RenderCommand>(opaqueCount);
+        transparentCommands = frameAllocator.allocateArray<RenderCommand>(transparentCount);
+        for (const RenderCommandBuffer &buffer : commandBuffers)
+        {
+            for (size_t i = 0; i < buffer.opaqueCount; i++)
+                opaqueCommands.push_back(buffer.commands[i]);
+            // The transparent commands are stored backwards from the end of the buffer
+            for (size_t i = 0; i < buffer.transparentCount; i++)
+                transparentCommands.push_back(buffer.commands[buffer.commands.size() - 1 - i]);
+        }
+        statistics.visibleCount = opaqueCommands.size() + transparentCommands.size();
+
+        //TODO: (Light) SEND THE LIST OF LIGHTS TO THE SHADER FOR LIGHTING SUPPORT
+        // Pack the data of all the light sources (up to MAX_LIGHT_COUNT) and upload it once for this frame.
+        // The directional lights are packed first since they reach every fragment, then the point and spot lights are binned
+        // into clusters. The ambient colors of all the lights are summed since the lit shaders add them once per fragment.
+        size_t lightCount = std::min<size_t>(lights.size(), MAX_LIGHT_COUNT);
+        lightData = frameAllocator.allocateArray<LightData>(lightCount);
+        lightData.resize(lightCount);
+        GLint directionalLightCount = 0;
+        size_t nextLocalLight = lightCount;
+        glm::vec3 ambientLight = glm::vec3(0.0f);
+        for (size_t j = 0; j < lightCount; j++)
+        {
+            LightComponent *light = lights[j];
+            // The directional lights are packed from the front and the other lights from the back
+            LightData &data = light->lightType == LightType::DIRECTIONAL ? lightData[directionalLightCount++] : lightData[--nextLocalLight];
+            data = LightData{};
+            // diffuse, specular and ambient for all light sources
+            data.type = (float)static_cast<GLint>(light->lightType);
+            data.diffuse = light->diffuse;
+            data.specular = light->specular;
+            data.ambient = light->ambient;
+            ambientLight += light->ambient;
+            // according to the light type pass the remaining parameters
+            // point and spot lights have a position and attenuation factors
+            if (light->lightType != LightType::DIRECTIONAL)
+            {
+                data.position = light->getOwner()->localTransform.position;
+                data.attenuation_constant = light->attenuation_constant;
+                data.attenuation_linear = light->attenuation_linear;
+                data.attenuation_quadratic = light->attenuation_quadratic;
+            }
+            // directional and spot lights have a direction
+            if (light->lightType != LightType::POINT)
+            {
+                data.direction = glm::normalize(light->getOwner()->localTransform.rotation);
+            }
+            // and spot lights have cone angles
+            if (light->lightType == LightType::SPOT)
+            {
+                data.inner_angle = light->inner_angle;
+                data.outer_angle = light->outer_angle;
+            }
+        }
+        lightsBuffer->update(lightData.data(), lightCount * sizeof(LightData));
+        lightsBuffer->bind(TEXTURE_UNIT_LIGHT_DATA);
+        lightClusters.build(lightData.data(), directionalLightCount, lightCount - directionalLightCount,
+                            VM, projection, camera->near, camera->far, frameAllocator);
+        lightClusters.bind();
+        statistics.lightCount = lightCount;
+        statistics.lightIndexCount = lightClusters.getIndexCount();
+
+        // The camera position and forward direction in the world space are used to compute the depth of the commands
+        // The world matrices were refreshed by "updateTransforms" at the start of the frame, so the cached one is up to date
+        const glm::mat4& cameraMatrix = camera->getOwner()->getCachedLocalToWorldMatrix();
+        glm::vec3 eye = glm::vec3(cameraMatrix * glm::vec4(0, 0, 0, 1));
+        glm::vec3 eyeForward = glm::normalize(glm::vec3(cameraMatrix * glm::vec4(0, 0, -1, 0)));
+
+        //TODO: (Req 9) Finish this function
+        // Sort the transparent commands back-to-front. The depth of each command is computed once into a key
+        // (see "computeTransparentSortKey") then the keys are radix sorted instead of comparing the commands.
+        // The commands drawn by the order independent transparency pass don't need to be sorted so they are skipped
+        bool useOIT = transparencyMode == TransparencyMode::WEIGHTED_BLENDED;
+        size_t oitCount = 0;
+        transparentOrder = frameAllocator.allocateArray<SortEntry<std::uint32_t>>(transparentCommands.size());
+        transparentScratch = frameAllocator.allocateArray<SortEntry<std::uint32_t>>(transparentCommands.size());
+        for (std::uint32_t i = 0; i < transparentCommands.size(); i++)
+        {
+            if (useOIT && transparentCommands[i].material->supportsOIT())
+                oitCount++;
+            else
+                transparentOrder.push_back({computeTransparentSortKey(transparentCommands[i], eye, eyeForward), i});
+        }
+        radixSort(transparentOrder.data(), transparentScratch.data(), transparentOrder.size());
+
+        // Sort the opaque commands by their state and depth (see "computeOpaqueSortKey")
+        opaqueOrder = frameAllocator.allocateArray<SortEntry<std::uint64_t>>(opaqueCommands.size());
+        sortScratch = frameAllocator.allocateArray<SortEntry<std::uint64_t>>(opaqueCommands.size());
+        opaqueOrder.resize(opaqueCommands.size());
+        sortScratch.resize(opaqueCommands.size());
+        for (std::uint32_t i = 0; i < opaqueCommands.size(); i++)
+            opaqueOrder[i] = {computeOpaqueSortKey(opaqueCommands[i], eye, eyeForward, camera->far), i};
+        radixSort(opaqueOrder.data(), sortScratch.data(), opaqueOrder.size());
+
+        // TODO: (Req 10) Get the camera position
+        glm::vec3 cameraPosition = camera->getOwner()->localTransform.position;
+
+        // Upload the constants shared by all the objects in this frame
+        FrameConstants frameConstants{};
+        frameConstants.view = VM;
+        frameConstants.projection = projection;
+        frameConstants.VP = VP;
+        frameConstants.cameraPosition = cameraPosition;
+        frameConstants.time = (float)glfwGetTime();
+        frameConstants.ambient_light = ambientLight;
+        frameConstants.directional_light_count = directionalLightCount;
+        frameConstants.cluster_count = lightClusters.getClusterCount();
+        frameConstants.cluster_depth_scale = lightClusters.getDepthScale();
+        frameConstants.cluster_tile_size = lightClusters.getTileSize();
+        frameConstants.cluster_depth_bias = lightClusters.getDepthBias();
+        frameConstantsBuffer->update(&frameConstants, sizeof(FrameConstants));
+        frameConstantsBuffer->bind(UNIFORM_BLOCK_BINDING_FRAME);
 
         // TODO: (Req 9) Set the OpenGL viewport using viewportStart and viewportSize
         glViewport(0, 0, windowSize.x, windowSize.y);
@@ -192,11 +622,11 @@ namespace our
         glClearDepth(1);
 
         // TODO: (Req 9) Set the color mask to true and the depth mask to true (to ensure the glClear will affect the framebuffer)
-        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
-        glDepthMask(GL_TRUE);
+        GLStateCache::colorMask(true, true, true, true);
+        GLStateCache::depthMask(true);
 
-        // If there is a postprocess material, bind the framebuffer
-        if (postprocessMaterial)
+        // If the scene is drawn offscreen (for the postprocessing or the order independent transparency), bind the framebuffer
+        if (offscreen)
         {
             // TODO: (Req 11) bind the framebuffer
             glBindFramebuffer(GL_FRAMEBUFFER, postprocessFrameBuffer);
@@ -205,69 +635,30 @@ namespace our
         // TODO: (Req 9) Clear the color and depth buffers
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        // TODO: (Req 9) Draw all the opaque commands
-        // Don't forget to set the "transform" uniform to be equal the model-view-projection matrix for each render
-        // TODO: (Req 10) Get the camera position
-        glm::vec3 cameraPosition = camera->getOwner()->localTransform.position;
-        for (unsigned long int i = 0; i < opaqueCommands.size(); i++)
+        // Read the statistics of the queries issued 2 frames ago (they are usually done by now so this doesn't stall)
+        size_t querySet = renderedFrameCount % 2;
+        if (renderedFrameCount >= 2)
         {
-            opaqueCommands[i].material->transparent = false;
-            opaqueCommands[i].material->setup();
-
-            //TODO: (Light) SEND THE NEEDED TRANSFORMS TO THE SHADER FOR LIGHTING SUPPORT
-            // send the needed uniforms for the shaders
-            opaqueCommands[i].material->shader->set("transform", VP * opaqueCommands[i].localToWorld);
-            // pass mat4 that transforms local space to world space to calculate world vector
-            opaqueCommands[i].material->shader->set("objectToWorld", opaqueCommands[i].localToWorld);
-            // mat4 that represents the object to world inverse transpose for the normal
-            opaqueCommands[i].material->shader->set("objectToInvTranspose", glm::transpose(glm::inverse(opaqueCommands[i].localToWorld)));
-            // send camera position for the view vector
-            opaqueCommands[i].material->shader->set("cameraPosition", cameraPosition);
-
-            //TODO: (Light) SEND THE LIST OF LIGHTS TO THE SHADER FOR LIGHTING SUPPORT
-            // loop over all light sources and pass their data to the shaders
-            for (int j = 0; j < lights.size(); j++)
-            {
-                // diffuse, specular and ambient for all light sources
-                opaqueCommands[i].material->shader->set("lights[" + std::to_string(j) + "]." + "diffuse", lights[j]->diffuse);
-                opaqueCommands[i].material->shader->set("lights[" + std::to_string(j) + "]." + "specular", lights[j]->specular);
-                opaqueCommands[i].material->shader->set("lights[" + std::to_string(j) + "]." + "ambient", lights[j]->ambient);
-                // passing the light type point, directional or spot
-                opaqueCommands[i].material->shader->set("lights[" + std::to_string(j) + "]." + "type", static_cast<int>(lights[j]->lightType));
-
-                // according to the light type pass the remaining parameters
-                switch (lights[j]->lightType)
-                {
-                case LightType::DIRECTIONAL:
-                    // in case of directional light pass the light's direction
-                    opaqueCommands[i].material->shader->set("lights[" + std::to_string(j) + "]." + "direction", glm::normalize(lights[j]->getOwner()->localTransform.rotation));
-                    break;
-                case LightType::POINT:
-                    // in case of point light pass its positiins
-                    opaqueCommands[i].material->shader->set("lights[" + std::to_string(j) + "]." + "position", lights[j]->getOwner()->localTransform.position);
-                    // and the attenuation factors
-                    opaqueCommands[i].material->shader->set("lights[" + std::to_string(j) + "]." + "attenuation_constant", lights[j]->attenuation_constant);
-                    opaqueCommands[i].material->shader->set("lights[" + std::to_string(j) + "]." + "attenuation_linear", lights[j]->attenuation_linear);
-                    opaqueCommands[i].material->shader->set("lights[" + std::to_string(j) + "]." + "attenuation_quadratic", lights[j]->attenuation_quadratic);
-                    break;
-                case LightType::SPOT:
-                    // in case of spot light pass its position and direction
-                    opaqueCommands[i].material->shader->set("lights[" + std::to_string(j) + "]." + "position", lights[j]->getOwner()->localTransform.position);
-                    opaqueCommands[i].material->shader->set("lights[" + std::to_string(j) + "]." + "direction", glm::normalize(lights[j]->getOwner()->localTransform.rotation));
-                    // its attenuation factors
-                    opaqueCommands[i].material->shader->set("lights[" + std::to_string(j) + "]." + "attenuation_constant", lights[j]->attenuation_constant);
-                    opaqueCommands[i].material->shader->set("lights[" + std::to_string(j) + "]." + "attenuation_linear", lights[j]->attenuation_linear);
-                    opaqueCommands[i].material->shader->set("lights[" + std::to_string(j) + "]." + "attenuation_quadratic", lights[j]->attenuation_quadratic);
-                    // and cone angles
-                    opaqueCommands[i].material->shader->set("lights[" + std::to_string(j) + "]." + "inner_angle", lights[j]->inner_angle);
-                    opaqueCommands[i].material->shader->set("lights[" + std::to_string(j) + "]." + "outer_angle", lights[j]->outer_angle);
-                    break;
-                }
-            }
-            // lastly pass the light count to be used in shaders when looping over the lights
-            opaqueCommands[i].material->shader->set("light_count", (GLint)lights.size());
-            opaqueCommands[i].mesh->draw();
+            GLuint64 samples = 0, time = 0;
+            glGetQueryObjectui64v(opaqueSamplesQueries[querySet], GL_QUERY_RESULT, &samples);
+            glGetQueryObjectui64v(opaqueTimeQueries[querySet], GL_QUERY_RESULT, &time);
+            statistics.opaqueShadedSamples = samples;
+            statistics.opaqueGPUTime = time;
         }
+        renderedFrameCount++;
+
+        // TODO: (Req 9) Draw all the opaque commands
+        // Don't forget to set the "transform" uniform to be equal the model-view-projection matrix for each render
+        // A batch can't be larger than the opaque commands, so the matrices of every batch fit in this array
+        instanceMatrices = frameAllocator.allocateArray<glm::mat4>(opaqueCommands.size());
+        glBeginQuery(GL_TIME_ELAPSED, opaqueTimeQueries[querySet]);
+        // If the depth pre-pass is enabled, the depth of the opaque objects is drawn first (see "depthPrepass")
+        if (depthPrepass)
+            drawOpaqueCommands(VP, true);
+        glBeginQuery(GL_SAMPLES_PASSED, opaqueSamplesQueries[querySet]);
+        drawOpaqueCommands(VP, false);
+        glEndQuery(GL_SAMPLES_PASSED);
+        glEndQuery(GL_TIME_ELAPSED);
 
         // If there is a sky material, draw the sky
         if (this->skyMaterial)
@@ -281,7 +672,6 @@ namespace our
             view[2][3] = cameraPosition[2];
             // TODO: (Req 10) We want the sky to be drawn behind everything (in NDC space, z=1)
             //  We can acheive this by multiplying by an extra matrix after the projection but what values should we put in it?
-            glm::mat4 projection = camera->getProjectionMatrix(windowSize);
             float far = camera->far;
             glm::mat4 alwaysBehindTransform = glm::mat4(
                 1.0f, 0.0f, 0.0f, 0.0f,
@@ -289,69 +679,72 @@ namespace our
                 0.0f, 0.0f, 0.0f, 0.0f,
                 0.0f, 0.0f, 1.0f, 1.0f);
             // TODO: (Req 10) set the "transform" uniform
-            skyMaterial->shader->set("transform", alwaysBehindTransform * projection * view);
+            skyMaterial->shader->set(uniforms::TRANSFORM, alwaysBehindTransform * projection * view);
             // TODO: (Req 10) draw the sky sphere
             skySphere->draw();
         }
-        // TODO: (Req 9) Draw all the transparent commands
-        // Don't forget to set the "transform" uniform to be equal the model-view-projection matrix for each render command
-        for (unsigned long int i = 0; i < transparentCommands.size(); i++)
+        // Draw the transparent commands that support the order independent transparency in any order
+        if (oitCount > 0)
         {
-            transparentCommands[i].material->transparent = true;
-            transparentCommands[i].material->setup();
-            //TODO: (Light) SEND THE NEEDED TRANSFORMS TO THE SHADER FOR LIGHTING SUPPORT
-            // send the needed uniforms for the shaders
-            transparentCommands[i].material->shader->set("transform", VP * transparentCommands[i].localToWorld);
-            // pass mat4 that transforms local space to world space to calculate world vector
-            transparentCommands[i].material->shader->set("objectToWorld", transparentCommands[i].localToWorld);
-            // mat4 that represents the object to world inverse transpose for the normal
-            transparentCommands[i].material->shader->set("objectToInvTranspose", glm::transpose(glm::inverse(transparentCommands[i].localToWorld)));
-            // send camera position for the view vector
-            transparentCommands[i].material->shader->set("cameraPosition", cameraPosition);
-
-            //TODO: (Light) SEND THE LIST OF LIGHTS TO THE SHADER FOR LIGHTING SUPPORT 
-            // loop over all light sources and pass their data to the shaders
-            for (int j = 0; j < lights.size(); j++)
+            glBindFramebuffer(GL_FRAMEBUFFER, oitFrameBuffer);
+            // The colors and weights are summed from 0 while the revealage (the alpha of the accumulation) is multiplied from 1
+            const GLfloat accumulationClear[] = {0.0f, 0.0f, 0.0f, 1.0f};
+            const GLfloat weightClear[] = {0.0f, 0.0f, 0.0f, 0.0f};
+            glClearBufferfv(GL_COLOR, 0, accumulationClear);
+            glClearBufferfv(GL_COLOR, 1, weightClear);
+            Material *lastOITMaterial = nullptr;
+            for (const RenderCommand &command : transparentCommands)
             {
-                // diffuse, specular and ambient for all light sources
-                transparentCommands[i].material->shader->set("lights[" + std::to_string(j) + "]." + "diffuse", lights[j]->diffuse);
-                transparentCommands[i].material->shader->set("lights[" + std::to_string(j) + "]." + "specular", lights[j]->specular);
-                transparentCommands[i].material->shader->set("lights[" + std::to_string(j) + "]." + "ambient", lights[j]->ambient);
-                // passing the light type point, directional or spot
-                transparentCommands[i].material->shader->set("lights[" + std::to_string(j) + "]." + "type", static_cast<int>(lights[j]->lightType));
-
-                // according to the light type pass the remaining parameters
-                switch (lights[j]->lightType)
+                if (!command.material->supportsOIT())
+                    continue;
+                if (command.material != lastOITMaterial)
                 {
-                case LightType::DIRECTIONAL:
-                    // in case of directional light pass the light's direction
-                    transparentCommands[i].material->shader->set("lights[" + std::to_string(j) + "]." + "direction", glm::normalize(lights[j]->getOwner()->localTransform.rotation));
-                    break;
-                case LightType::POINT:
-                    // in case of point light pass its positiins
-                    transparentCommands[i].material->shader->set("lights[" + std::to_string(j) + "]." + "position", lights[j]->getOwner()->localTransform.position);
-                    // and the attenuation factors
-                    transparentCommands[i].material->shader->set("lights[" + std::to_string(j) + "]." + "attenuation_constant", lights[j]->attenuation_constant);
-                    transparentCommands[i].material->shader->set("lights[" + std::to_string(j) + "]." + "attenuation_linear", lights[j]->attenuation_linear);
-                    transparentCommands[i].material->shader->set("lights[" + std::to_string(j) + "]." + "attenuation_quadratic", lights[j]->attenuation_quadratic);
-                    break;
-                case LightType::SPOT:
-                    // in case of spot light pass its position and direction
-                    transparentCommands[i].material->shader->set("lights[" + std::to_string(j) + "]." + "position", lights[j]->getOwner()->localTransform.position);
-                    transparentCommands[i].material->shader->set("lights[" + std::to_string(j) + "]." + "direction", glm::normalize(lights[j]->getOwner()->localTransform.rotation));
-                    // its attenuation factors
-                    transparentCommands[i].material->shader->set("lights[" + std::to_string(j) + "]." + "attenuation_constant", lights[j]->attenuation_constant);
-                    transparentCommands[i].material->shader->set("lights[" + std::to_string(j) + "]." + "attenuation_linear", lights[j]->attenuation_linear);
-                    transparentCommands[i].material->shader->set("lights[" + std::to_string(j) + "]." + "attenuation_quadratic", lights[j]->attenuation_quadratic);
-                    // and cone angles
-                    transparentCommands[i].material->shader->set("lights[" + std::to_string(j) + "]." + "inner_angle", lights[j]->inner_angle);
-                    transparentCommands[i].material->shader->set("lights[" + std::to_string(j) + "]." + "outer_angle", lights[j]->outer_angle);
-                    break;
+                    command.material->setup(ShaderVariant::OIT);
+                    // Whatever the blending of the material is, the accumulation must be additive and the revealage multiplicative.
+                    // OpenGL 3.3 has no per-target blending so the revealage is kept in the alpha channel with its own blend factors.
+                    // The depth is tested against the opaque objects but it is not written since the order doesn't matter
+                    GLStateCache::setEnabled(GL_BLEND, true);
+                    GLStateCache::blendEquation(GL_FUNC_ADD);
+                    GLStateCache::blendFuncSeparate(GL_ONE, GL_ONE, GL_ZERO, GL_ONE_MINUS_SRC_ALPHA);
+                    GLStateCache::depthMask(false);
+                    lastOITMaterial = command.material;
                 }
+                sendObjectUniforms(command.material->getShader(ShaderVariant::OIT), command, VP);
+                command.mesh->draw();
             }
-            // lastly pass the light count to be used in shaders when looping over the lights
-            transparentCommands[i].material->shader->set("light_count", (GLint)lights.size());
-            transparentCommands[i].mesh->draw();
+
+            // Composite the average transparent color over the scene
+            glBindFramebuffer(GL_FRAMEBUFFER, postprocessFrameBuffer);
+            GLStateCache::setEnabled(GL_DEPTH_TEST, false);
+            GLStateCache::setEnabled(GL_CULL_FACE, false);
+            GLStateCache::setEnabled(GL_BLEND, true);
+            GLStateCache::blendEquation(GL_FUNC_ADD);
+            GLStateCache::blendFunc(GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA);
+            oitCompositeShader->use();
+            GLStateCache::activeTexture(0);
+            oitAccumulationTarget->bind();
+            Sampler::unbind(0);
+            GLStateCache::activeTexture(1);
+            oitWeightTarget->bind();
+            Sampler::unbind(1);
+            oitCompositeShader->set(uniforms::OIT_ACCUMULATION, 0);
+            oitCompositeShader->set(uniforms::OIT_WEIGHTS, 1);
+            glBindVertexArray(postProcessVertexArray);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+            glBindVertexArray(0);
+        }
+
+        // TODO: (Req 9) Draw all the transparent commands
+        // Don't forget to set the "transform" uniform to be equal the model-view-projection matrix for each render command
+        for (const auto &entry : transparentOrder)
+        {
+            RenderCommand &command = transparentCommands[entry.index];
+            command.material->transparent = true;
+            command.material->setup();
+            //TODO: (Light) SEND THE NEEDED TRANSFORMS TO THE SHADER FOR LIGHTING SUPPORT
+            // the camera data and the lights are already in the uniform buffers, so we only send the object transforms
+            sendObjectUniforms(command.material->shader, command, VP);
+            command.mesh->draw();
         }
 
         // If there is a postprocess material, apply postprocessing
@@ -365,6 +758,17 @@ namespace our
             glDrawArrays(GL_TRIANGLES, 0, 3);
             glBindVertexArray(0);
         }
+        else if (offscreen)
+        {
+            // The scene was only drawn offscreen for the order independent transparency so we copy it to the window
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, postprocessFrameBuffer);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+            glBlitFramebuffer(0, 0, windowSize.x, windowSize.y, 0, 0, windowSize.x, windowSize.y, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        }
+
+        // Keep the state cache counters of this frame (they were reset at the start of "render")
+        statistics.stateCache = GLStateCache::getStatistics();
     }
 
 }
\ No newline at end of file
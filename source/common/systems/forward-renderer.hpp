@@ -5,6 +5,12 @@
 #include "../components/mesh-renderer.hpp"
 #include "../components/light.hpp"
 #include "../asset-loader.hpp"
+#include "../shader/uniform-buffer.hpp"
+#include "../thread-pool.hpp"
+#include "../frame-allocator.hpp"
+#include "../gl-state-cache.hpp"
+#include "radix-sort.hpp"
+#include "light-clusters.hpp"
 
 #include <glad/gl.h>
 #include <vector>
@@ -24,6 +30,70 @@ namespace our
         Material* material;
     };
 
+    // The maximum number of lights sent to the lit shaders. The point and spot lights are binned into clusters (see "LightClusters")
+    // so each fragment only pays for the lights that reach it
+    #define MAX_LIGHT_COUNT 4096
+    // The minimum number of consecutive commands with the same mesh and material that are drawn with an instanced draw call
+    #define MIN_INSTANCED_BATCH_SIZE 2
+    // The minimum number of mesh renderers gathered by a single job when the renderer is given a thread pool
+    #define MIN_COMMANDS_PER_JOB 256
+
+    // This struct mirrors the "FrameConstants" uniform block of the lit shaders following the std140 layout rules.
+    // It holds the data that is the same for every object in the frame so it is uploaded once per frame
+    struct FrameConstants {
+        glm::mat4 view;
+        glm::mat4 projection;
+        glm::mat4 VP;
+        glm::vec3 cameraPosition;
+        float time;
+        glm::vec3 ambient_light;            // The sum of the ambient colors of all the lights
+        GLint directional_light_count;      // The directional lights are the first lights in the light buffer
+        glm::ivec3 cluster_count;           // The parameters of the light clusters (see "LightClusters")
+        float cluster_depth_scale;
+        glm::vec2 cluster_tile_size;
+        float cluster_depth_bias;           float pad0;
+    };
+    static_assert(sizeof(FrameConstants) == 256, "FrameConstants must match the std140 layout of the FrameConstants block in the lit shaders");
+
+    // The number of render commands that were drawn or rejected by the frustum culling in the last frame
+    // and the memory used by the per-frame arrays of the renderer in the last frame and at most (in bytes).
+    // The light counters show how many lights were sent and how many (cluster, light) pairs the clusters hold.
+    // The GPU counters of the opaque pass are read from queries issued 2 frames earlier (to avoid waiting for the GPU):
+    // the number of samples that passed the depth test in the color pass (the fragments that were shaded)
+    // and the GPU time of the opaque pass including the depth pre-pass (in nanoseconds).
+    // The state cache counters are the state calls and the texture/sampler binds that were issued or skipped while rendering the last frame.
+    struct RenderStatistics {
+        size_t visibleCount = 0;
+        size_t culledCount = 0;
+        size_t frameBytes = 0;
+        size_t peakFrameBytes = 0;
+        size_t lightCount = 0;        // The number of lights sent to the lit shaders
+        size_t lightIndexCount = 0;   // The number of light indices stored in the light clusters
+        std::uint64_t opaqueShadedSamples = 0;
+        std::uint64_t opaqueGPUTime = 0;
+        GLStateStatistics stateCache;
+    };
+
+    // The commands gathered from one chunk of the mesh renderers. Each chunk has its own buffer
+    // so that the chunks can be gathered on different threads without synchronization.
+    // The buffer has room for every mesh renderer of the chunk: the opaque commands are stored from the front
+    // and the transparent commands are stored from the back (so they are in the reverse order)
+    struct RenderCommandBuffer {
+        FrameArray<RenderCommand> commands;
+        size_t opaqueCount = 0;
+        size_t transparentCount = 0;
+        size_t culledCount = 0;
+    };
+
+    // The initial size of the memory used by the per-frame arrays of the renderer (it grows if a frame needs more)
+    #define RENDERER_FRAME_MEMORY (1 << 20)
+
+    // How the renderer draws the transparent objects (selected by "transparency" in the renderer config)
+    enum class TransparencyMode {
+        SORTED,          // "sorted": Sorted back-to-front then blended using the pipeline state of their materials
+        WEIGHTED_BLENDED // "weighted-blended": Weighted blended order independent transparency (no sorting, see "oit_composite.frag")
+    };
+
     // A forward renderer is a renderer that draw the object final color directly to the framebuffer
     // In other words, the fragment shader in the material should output the color that we should see on the screen
     // This is different from more complex renderers that could draw intermediate data to a framebuffer before computing the final color
@@ -31,14 +101,31 @@ namespace our
     class ForwardRenderer {
         // These window size will be used on multiple occasions (setting the viewport, computing the aspect ratio, etc.)
         glm::ivec2 windowSize;
-        // These are two vectors in which we will store the opaque and the transparent commands.
-        // We define them here (instead of being local to the "render" function) as an optimization to prevent reallocating them every frame
-        std::vector<RenderCommand> opaqueCommands;
-        std::vector<RenderCommand> transparentCommands;
+        // All the arrays below only live for one frame, so their memory comes from this allocator which is reset
+        // at the start of every frame. This way, the frame loop doesn't allocate from the heap.
+        FrameAllocator frameAllocator = FrameAllocator(RENDERER_FRAME_MEMORY);
+        // These are two arrays in which we will store the opaque and the transparent commands.
+        FrameArray<RenderCommand> opaqueCommands;
+        FrameArray<RenderCommand> transparentCommands;
+        // The per-chunk buffers filled while gathering the commands then merged into the two arrays above
+        FrameArray<RenderCommandBuffer> commandBuffers;
+        // The opaque commands are drawn in the order of their sort keys (see "computeOpaqueSortKey" in forward-renderer.cpp)
+        // so that the commands sharing the same state are drawn consecutively. "sortScratch" is used by the radix sort.
+        FrameArray<SortEntry<std::uint64_t>> opaqueOrder, sortScratch;
+        // The transparent commands are drawn back-to-front in the order of their depth keys (see "computeTransparentSortKey")
+        FrameArray<SortEntry<std::uint32_t>> transparentOrder, transparentScratch;
+        // The per-instance matrices of the current instanced batch
+        FrameArray<glm::mat4> instanceMatrices;
         //TODO: (Light) Add List of lights in the scene
         //List of lights in the scene
-        std::vector<LightComponent*> lights;
-        //std::vector<std::pair<glm::vec3, glm::vec3>> lights_position_direction;
+        FrameArray<LightComponent*> lights;
+        // The light data is packed here (the directional lights first) then uploaded once per frame to the "light_data" texture buffer
+        FrameArray<LightData> lightData;
+        TextureBuffer* lightsBuffer = nullptr;
+        // The point and spot lights are binned into these clusters every frame
+        LightClusters lightClusters;
+        // The camera and scene data that is shared by all the objects is uploaded once per frame to the "FrameConstants" uniform block
+        UniformBuffer* frameConstantsBuffer = nullptr;
         // Objects used for rendering a skybox
         Mesh* skySphere;
         TexturedMaterial* skyMaterial;
@@ -46,14 +133,44 @@ namespace our
         GLuint postprocessFrameBuffer, postProcessVertexArray;
         Texture2D *colorTarget, *depthTarget;
         TexturedMaterial* postprocessMaterial;
+        // The scene is drawn to "postprocessFrameBuffer" (instead of the window) if there is a postprocess shader
+        // or if the order independent transparency needs the depth of the opaque objects in a texture
+        bool offscreen = false;
+        // Objects used for the order independent transparency. The transparent objects whose materials have an "oitShader"
+        // are drawn into the accumulation target (RGBA16F) and the weight target (R16F), then they are composited over the scene.
+        // The other transparent objects are still sorted and drawn after the composite.
+        TransparencyMode transparencyMode = TransparencyMode::SORTED;
+        GLuint oitFrameBuffer = 0;
+        Texture2D *oitAccumulationTarget = nullptr, *oitWeightTarget = nullptr;
+        ShaderProgram *oitCompositeShader = nullptr;
+        // If "depthPrepass" is true in the renderer config, the depth of the opaque objects is drawn first with the depth-only shaders
+        // (see "depth.vert"), then their colors are drawn with the depth function GL_EQUAL so that the expensive fragment shaders
+        // only run for the visible fragments. "depthTransformShader" is used with the material shaders that receive the full "transform".
+        bool depthPrepass = false;
+        ShaderProgram *depthShader = nullptr, *depthTransformShader = nullptr, *depthInstancedShader = nullptr;
+        // The queries that measure the opaque pass (see "RenderStatistics"). There are 2 sets that are used in alternate frames
+        GLuint opaqueSamplesQueries[2] = {0, 0}, opaqueTimeQueries[2] = {0, 0};
+        size_t renderedFrameCount = 0;
+        // The statistics of the last rendered frame
+        RenderStatistics statistics;
+
+        // Returns true if the color of the given material is drawn after the depth pre-pass
+        bool usesDepthPrepass(const Material *material) const;
+        // Draws the opaque commands in the order of "opaqueOrder". If "depthOnly" is true, only the depth of the commands
+        // that use the depth pre-pass is drawn
+        void drawOpaqueCommands(const glm::mat4 &VP, bool depthOnly);
     public:
         // Initialize the renderer including the sky and the Postprocessing objects.
         // windowSize is the width & height of the window (in pixels).
         void initialize(glm::ivec2 windowSize, const nlohmann::json& config);
         // Clean up the renderer
         void destroy();
-        // This function should be called every frame to draw the given world
-        void render(World* world);
+        // This function should be called every frame to draw the given world.
+        // If a thread pool is given, the world matrices are updated and the render commands are gathered and culled on it,
+        // while the OpenGL calls are always issued from the calling thread
+        void render(World* world, ThreadPool* pool = nullptr);
+        // Returns the statistics of the last rendered frame
+        const RenderStatistics& getStatistics() const { return statistics; }
 
 
     };
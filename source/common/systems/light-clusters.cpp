@@ -0,0 +1,255 @@
+#include "light-clusters.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace our
+{
+
+    // The bounding sphere of a light in the view space, the range of the slices that it reaches (both included) and its index.
+    // The tiles that it covers in each of these slices are stored in a separate array starting at "firstRect"
+    struct LightBounds {
+        glm::vec3 center;
+        float radius;
+        int firstSlice, lastSlice;
+        std::uint32_t index;
+        size_t firstRect;
+    };
+
+    // A rectangle of tiles (both corners are included, so it is empty if "min" is larger than "max")
+    struct TileRect {
+        glm::ivec2 min, max;
+    };
+
+    // The bounding box of a cluster in the view space
+    struct ClusterBounds {
+        glm::vec3 min, max;
+    };
+
+    static bool intersects(const ClusterBounds &bounds, const glm::vec3 &center, float radius)
+    {
+        glm::vec3 offset = center - glm::clamp(center, bounds.min, bounds.max);
+        return glm::dot(offset, offset) <= radius * radius;
+    }
+
+    void LightClusters::initialize(glm::ivec2 viewportSize)
+    {
+        this->viewportSize = viewportSize;
+        clusterCount = glm::ivec3(
+            std::max(1, (viewportSize.x + CLUSTER_TILE_SIZE - 1) / CLUSTER_TILE_SIZE),
+            std::max(1, (viewportSize.y + CLUSTER_TILE_SIZE - 1) / CLUSTER_TILE_SIZE),
+            CLUSTER_DEPTH_SLICES);
+        GLint maxTexels = 0;
+        glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+        maxIndexCount = (size_t)maxTexels;
+        clusterBuffer = new TextureBuffer(GL_RG32UI);
+        indexBuffer = new TextureBuffer(GL_R32UI);
+    }
+
+    void LightClusters::destroy()
+    {
+        delete clusterBuffer;
+        delete indexBuffer;
+        clusterBuffer = indexBuffer = nullptr;
+    }
+
+    float LightClusters::getLightRadius(const LightData &light)
+    {
+        // The ambient color is included since "lit_texture.frag" also scales the diffuse and specular terms by it
+        float intensity = std::max({light.diffuse.r, light.diffuse.g, light.diffuse.b,
+                                    light.specular.r, light.specular.g, light.specular.b,
+                                    light.ambient.r, light.ambient.g, light.ambient.b});
+        if (intensity <= 0.0f)
+            return 0.0f;
+        // The attenuation is 1 / (a + b*d + c*d^2), so we solve a + b*d + c*d^2 = intensity / cutoff for the distance d
+        float target = intensity / LIGHT_ATTENUATION_CUTOFF;
+        float a = light.attenuation_constant, b = light.attenuation_linear, c = light.attenuation_quadratic;
+        if (a >= target)
+            return 0.0f;
+        if (c > 0.0f)
+            return (-b + std::sqrt(b * b + 4.0f * c * (target - a))) / (2.0f * c);
+        if (b > 0.0f)
+            return (target - a) / b;
+        return std::numeric_limits<float>::infinity();
+    }
+
+    void LightClusters::build(const LightData *lights, size_t first, size_t count,
+                              const glm::mat4 &view, const glm::mat4 &projection, float near, float far, FrameAllocator &allocator)
+    {
+        // The slices are spaced exponentially: slice "i" starts at the depth near * (far / near)^(i / sliceCount)
+        near = std::max(near, 1e-3f);
+        far = std::max(far, near * 2.0f);
+        float logRange = std::log(far / near);
+        depthScale = clusterCount.z / logRange;
+        depthBias = -clusterCount.z * std::log(near) / logRange;
+        auto getSlice = [&](float depth)
+        {
+            return glm::clamp((int)std::floor(std::log(depth) * depthScale + depthBias), 0, clusterCount.z - 1);
+        };
+        auto getClusterIndex = [&](int x, int y, int z)
+        {
+            return (size_t)x + (size_t)clusterCount.x * ((size_t)y + (size_t)clusterCount.y * (size_t)z);
+        };
+
+        size_t totalClusterCount = (size_t)clusterCount.x * clusterCount.y * clusterCount.z;
+        FrameArray<float> sliceDepths = allocator.allocateArray<float>(clusterCount.z + 1);
+        for (int z = 0; z <= clusterCount.z; z++)
+            sliceDepths.push_back(near * std::pow(far / near, (float)z / clusterCount.z));
+        // The box of each cluster is found by moving the rays through its tile corners (unprojected from the near and the far planes)
+        // to the depths of its slice. It is used to reject the clusters that a light's screen rectangle covers but its sphere doesn't reach
+        glm::mat4 inverseProjection = glm::inverse(projection);
+        FrameArray<glm::vec3> rayStarts = allocator.allocateArray<glm::vec3>((clusterCount.x + 1) * (clusterCount.y + 1));
+        FrameArray<glm::vec3> rayEnds = allocator.allocateArray<glm::vec3>((clusterCount.x + 1) * (clusterCount.y + 1));
+        for (int y = 0; y <= clusterCount.y; y++)
+            for (int x = 0; x <= clusterCount.x; x++)
+            {
+                glm::vec2 ndc = glm::min(glm::vec2(x, y) * (float)CLUSTER_TILE_SIZE / glm::vec2(viewportSize), 1.0f) * 2.0f - 1.0f;
+                glm::vec4 start = inverseProjection * glm::vec4(ndc, -1.0f, 1.0f);
+                glm::vec4 end = inverseProjection * glm::vec4(ndc, 1.0f, 1.0f);
+                rayStarts.push_back(glm::vec3(start) / start.w);
+                rayEnds.push_back(glm::vec3(end) / end.w);
+            }
+        FrameArray<ClusterBounds> bounds = allocator.allocateArray<ClusterBounds>(totalClusterCount);
+        for (int z = 0; z < clusterCount.z; z++)
+        {
+            float sliceNear = sliceDepths[z], sliceFar = sliceDepths[z + 1];
+            for (int y = 0; y < clusterCount.y; y++)
+                for (int x = 0; x < clusterCount.x; x++)
+                {
+                    ClusterBounds box = {glm::vec3(std::numeric_limits<float>::max()), glm::vec3(-std::numeric_limits<float>::max())};
+                    for (int corner = 0; corner < 4; corner++)
+                    {
+                        size_t ray = (size_t)(x + (corner & 1)) + (size_t)(clusterCount.x + 1) * (size_t)(y + (corner >> 1));
+                        glm::vec3 start = rayStarts[ray], end = rayEnds[ray];
+                        for (float depth : {sliceNear, sliceFar})
+                        {
+                            glm::vec3 point = glm::mix(start, end, (depth + start.z) / (start.z - end.z));
+                            box.min = glm::min(box.min, point);
+                            box.max = glm::max(box.max, point);
+                        }
+                    }
+                    bounds.push_back(box);
+                }
+        }
+
+        // Find the lights that reach the view frustum
+        FrameArray<LightBounds> visibleLights = allocator.allocateArray<LightBounds>(count);
+        size_t rectCount = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            float radius = getLightRadius(lights[first + i]);
+            glm::vec3 center = glm::vec3(view * glm::vec4(lights[first + i].position, 1.0f));
+            float depth = -center.z;
+            if (radius <= 0.0f || depth - radius > far || depth + radius < near)
+                continue;
+            LightBounds light = {center, radius, getSlice(std::max(depth - radius, near)), getSlice(std::min(depth + radius, far)),
+                                 (std::uint32_t)(first + i), rectCount};
+            rectCount += light.lastSlice - light.firstSlice + 1;
+            visibleLights.push_back(light);
+        }
+
+        // Find the tiles covered by each light in each of its slices. The rectangle comes from the bounding box of the part
+        // of the sphere inside the slice (which is in front of the camera since the slices start at the near plane)
+        FrameArray<TileRect> rects = allocator.allocateArray<TileRect>(rectCount);
+        glm::vec2 tileScale = glm::vec2(viewportSize) / (2.0f * CLUSTER_TILE_SIZE);
+        glm::ivec2 lastTile(clusterCount.x - 1, clusterCount.y - 1);
+        for (const LightBounds &light : visibleLights)
+        {
+            float depth = -light.center.z;
+            for (int z = light.firstSlice; z <= light.lastSlice; z++)
+            {
+                TileRect rect = {glm::ivec2(0), glm::ivec2(-1)};
+                float sliceNear = sliceDepths[z], sliceFar = sliceDepths[z + 1];
+                // The radius of the sphere's cross section at the depth of the slice that is nearest to the center
+                float offset = glm::clamp(depth, sliceNear, sliceFar) - depth;
+                float squaredRadius = light.radius * light.radius - offset * offset;
+                if (squaredRadius >= 0.0f)
+                {
+                    float sectionRadius = std::sqrt(squaredRadius);
+                    if (!std::isfinite(sectionRadius))
+                    {
+                        // The light is not attenuated so it reaches the whole slice
+                        rect.max = lastTile;
+                    }
+                    else
+                    {
+                        float boxNear = std::max(depth - light.radius, sliceNear), boxFar = std::min(depth + light.radius, sliceFar);
+                        glm::vec2 ndcMin(std::numeric_limits<float>::max()), ndcMax(-std::numeric_limits<float>::max());
+                        for (int corner = 0; corner < 8; corner++)
+                        {
+                            glm::vec3 point(light.center.x + ((corner & 1) ? sectionRadius : -sectionRadius),
+                                            light.center.y + ((corner & 2) ? sectionRadius : -sectionRadius),
+                                            (corner & 4) ? -boxFar : -boxNear);
+                            glm::vec4 clip = projection * glm::vec4(point, 1.0f);
+                            glm::vec2 ndc = glm::vec2(clip) / clip.w;
+                            ndcMin = glm::min(ndcMin, ndc);
+                            ndcMax = glm::max(ndcMax, ndc);
+                        }
+                        if (ndcMax.x >= -1.0f && ndcMax.y >= -1.0f && ndcMin.x <= 1.0f && ndcMin.y <= 1.0f)
+                        {
+                            rect.min = glm::min(glm::ivec2(glm::floor((glm::clamp(ndcMin, -1.0f, 1.0f) + 1.0f) * tileScale)), lastTile);
+                            rect.max = glm::min(glm::ivec2(glm::floor((glm::clamp(ndcMax, -1.0f, 1.0f) + 1.0f) * tileScale)), lastTile);
+                        }
+                    }
+                }
+                rects.push_back(rect);
+            }
+        }
+
+        // Calls "function(cluster)" for each cluster of the light's rectangles that its sphere intersects
+        auto forEachCluster = [&](const LightBounds &light, auto &&function)
+        {
+            for (int z = light.firstSlice; z <= light.lastSlice; z++)
+            {
+                const TileRect &rect = rects[light.firstRect + (z - light.firstSlice)];
+                for (int y = rect.min.y; y <= rect.max.y; y++)
+                    for (int x = rect.min.x; x <= rect.max.x; x++)
+                    {
+                        size_t cluster = getClusterIndex(x, y, z);
+                        if (intersects(bounds[cluster], light.center, light.radius))
+                            function(cluster);
+                    }
+            }
+        };
+
+        // First, count the lights of each cluster
+        clusters = allocator.allocateArray<glm::uvec2>(totalClusterCount);
+        clusters.resize(totalClusterCount);
+        std::fill(clusters.begin(), clusters.end(), glm::uvec2(0));
+        for (const LightBounds &light : visibleLights)
+            forEachCluster(light, [&](size_t cluster) { clusters[cluster].y++; });
+
+        // Then, compute the offset of each cluster in the index list. If the list is larger than a texture buffer can be,
+        // the clusters at the end lose the lights that don't fit
+        size_t indexCount = 0;
+        for (glm::uvec2 &cluster : clusters)
+        {
+            std::uint32_t lightCount = (std::uint32_t)std::min<size_t>(cluster.y, maxIndexCount - indexCount);
+            cluster = glm::uvec2((std::uint32_t)indexCount, lightCount);
+            indexCount += lightCount;
+        }
+
+        // Finally, add the index of each light to its clusters
+        indices = allocator.allocateArray<std::uint32_t>(indexCount);
+        indices.resize(indexCount);
+        FrameArray<std::uint32_t> filled = allocator.allocateArray<std::uint32_t>(totalClusterCount);
+        filled.resize(totalClusterCount);
+        std::fill(filled.begin(), filled.end(), 0u);
+        for (const LightBounds &light : visibleLights)
+            forEachCluster(light, [&](size_t cluster)
+                           {
+                               if (filled[cluster] < clusters[cluster].y)
+                                   indices[clusters[cluster].x + filled[cluster]++] = light.index; });
+
+        clusterBuffer->update(clusters.data(), totalClusterCount * sizeof(glm::uvec2));
+        indexBuffer->update(indices.data(), indexCount * sizeof(std::uint32_t));
+    }
+
+    void LightClusters::bind() const
+    {
+        clusterBuffer->bind(TEXTURE_UNIT_CLUSTER_LIGHTS);
+        indexBuffer->bind(TEXTURE_UNIT_CLUSTER_LIGHT_INDICES);
+    }
+
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "../frame-allocator.hpp"
+#include "../texture/texture-buffer.hpp"
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+
+namespace our
+{
+
+    // This struct mirrors the light layout read by "readLight" in the lit shaders. Each light takes 6 RGBA32F texels
+    // of the light texture buffer, so the scalars are packed into the 4th component of the vectors.
+    struct LightData {
+        glm::vec3 position;     float type;
+        glm::vec3 diffuse;      float attenuation_constant;
+        glm::vec3 specular;     float attenuation_linear;
+        glm::vec3 ambient;      float attenuation_quadratic;
+        glm::vec3 direction;    float inner_angle;
+        float outer_angle;      float pad0[3];
+    };
+    static_assert(sizeof(LightData) == 6 * 4 * sizeof(float), "LightData must match the texel layout read by the lit shaders");
+
+    // The size (in pixels) of the screen tiles and the number of depth slices of the light clusters
+    #define CLUSTER_TILE_SIZE 64
+    #define CLUSTER_DEPTH_SLICES 24
+    // A light is considered to have no effect where its attenuation (scaled by its brightest color channel) drops below this value
+    #define LIGHT_ATTENUATION_CUTOFF (1.0f / 256.0f)
+
+    // Bins the point and spot lights into clusters so that the lit shaders only loop over the lights that can reach a fragment.
+    // The view frustum is split into screen tiles of CLUSTER_TILE_SIZE pixels and CLUSTER_DEPTH_SLICES depth slices
+    // (the slices are exponentially spaced between the near and the far planes so that they look the same size on screen).
+    // Each light is added to every cluster that its bounding sphere (see "getLightRadius") could overlap.
+    // The clusters are built on the CPU every frame and uploaded into two texture buffers:
+    // "cluster_lights" holds the offset and the count of each cluster's lights and "cluster_light_indices" holds the light indices.
+    class LightClusters {
+        glm::ivec3 clusterCount = glm::ivec3(0); // The number of tiles along x and y and the number of depth slices
+        glm::ivec2 viewportSize = glm::ivec2(0);
+        // The slice of a view depth "z" is "floor(log(z) * depthScale + depthBias)"
+        float depthScale = 0.0f, depthBias = 0.0f;
+        // The largest number of light indices that fit in the index buffer (GL_MAX_TEXTURE_BUFFER_SIZE)
+        size_t maxIndexCount = 0;
+        // The offset and the count of the lights of each cluster and the light indices of all the clusters (rebuilt every frame)
+        FrameArray<glm::uvec2> clusters;
+        FrameArray<std::uint32_t> indices;
+        TextureBuffer *clusterBuffer = nullptr, *indexBuffer = nullptr;
+    public:
+        // Creates the texture buffers and splits the viewport of the given size into tiles
+        void initialize(glm::ivec2 viewportSize);
+        void destroy();
+
+        // Bins the lights [first, first + count) of the given array into the clusters of the given camera then uploads the clusters.
+        // The indices stored in the clusters are the indices in the whole array. The arrays of the clusters are allocated from "allocator"
+        void build(const LightData* lights, size_t first, size_t count,
+                   const glm::mat4& view, const glm::mat4& projection, float near, float far, FrameAllocator& allocator);
+
+        // Binds the texture buffers of the clusters to their shared texture units
+        void bind() const;
+
+        // Returns the distance beyond which the light has no visible effect (see LIGHT_ATTENUATION_CUTOFF).
+        // It is infinite if the light is not attenuated
+        static float getLightRadius(const LightData& light);
+
+        glm::ivec3 getClusterCount() const { return clusterCount; }
+        glm::vec2 getTileSize() const { return glm::vec2(CLUSTER_TILE_SIZE); }
+        float getDepthScale() const { return depthScale; }
+        float getDepthBias() const { return depthBias; }
+        // Returns the number of light indices stored in the clusters by the last build
+        size_t getIndexCount() const { return indices.size(); }
+    };
+
+}
@@ -2,6 +2,7 @@
 
 #include "../ecs/world.hpp"
 #include "../components/movement.hpp"
+#include "../thread-pool.hpp"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
@@ -17,18 +18,30 @@ namespace our
     class MovementSystem {
     public:
 
+        // The minimum number of entities processed by a single job when a thread pool is used
+        static constexpr size_t MIN_ENTITIES_PER_JOB = 1024;
+
         // This should be called every frame to update all entities containing a MovementComponent. 
-        void update(World* world, float deltaTime) {
-            // For each entity in the world
-            for(auto entity : world->getEntities()){
-                // Get the movement component if it exists
-                MovementComponent* movement = entity->getComponent<MovementComponent>();
-                // If the movement component exists
-                if(movement){
-                    // Change the position and rotation based on the linear & angular velocity and delta time.
-                    entity->localTransform.position += deltaTime * movement->linearVelocity;
-                    entity->localTransform.rotation += deltaTime * movement->angularVelocity;
-                }
+        // If a thread pool is given, the entities are split into chunks that are updated in parallel.
+        void update(World* world, float deltaTime, ThreadPool* pool = nullptr) {
+            auto movers = world->query<MovementComponent, Transform>();
+            if(!pool){
+                move(movers, deltaTime);
+                return;
+            }
+            // Each entity is only touched by the job that owns its chunk, so the jobs don't need to synchronize
+            pool->parallelFor(movers.getCandidateCount(), MIN_ENTITIES_PER_JOB, [&](size_t begin, size_t end){
+                move(movers.slice(begin, end), deltaTime);
+            });
+        }
+
+    private:
+        static void move(const Query<MovementComponent, Transform>& movers, float deltaTime) {
+            // For each entity in the world that has a movement component
+            for(auto [movement, transform] : movers){
+                // Change the position and rotation based on the linear & angular velocity and delta time.
+                transform->position += deltaTime * movement->linearVelocity;
+                transform->rotation += deltaTime * movement->angularVelocity;
             }
         }
 
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+namespace our {
+
+    // An entry to be sorted by "radixSort": a sort key and the index of the item it belongs to.
+    // We sort these small entries instead of the items themselves to avoid moving big structs on every pass
+    template<typename Key>
+    struct SortEntry {
+        Key key;
+        std::uint32_t index;
+    };
+
+    // Sorts "count" entries in ascending order of their keys using a least significant digit radix sort (8 bits per pass).
+    // "scratch" must point to a buffer that can hold "count" entries; it is used to ping-pong between the passes.
+    // The sorted result is always stored back in "entries". The sort is stable.
+    // Passes where all the keys share the same byte are skipped, so keys that only use a few bits are sorted faster.
+    template<typename Key>
+    void radixSort(SortEntry<Key>* entries, SortEntry<Key>* scratch, std::size_t count) {
+        static_assert(std::is_unsigned<Key>::value, "The radix sort key must be an unsigned integer");
+        if(count < 2) return;
+        SortEntry<Key> *source = entries, *destination = scratch;
+        for(unsigned shift = 0; shift < sizeof(Key) * 8; shift += 8){
+            // Count how many keys fall in each bucket
+            std::size_t histogram[256] = {};
+            for(std::size_t i = 0; i < count; i++)
+                histogram[(source[i].key >> shift) & 0xFF]++;
+            // If all the keys are in the same bucket, this pass would not change the order
+            if(histogram[(source[0].key >> shift) & 0xFF] == count) continue;
+            // Turn the counts into the starting offset of each bucket
+            std::size_t offset = 0;
+            for(std::size_t& bucket : histogram){
+                std::size_t bucketCount = bucket;
+                bucket = offset;
+                offset += bucketCount;
+            }
+            // Scatter the entries to their buckets then swap the buffers
+            for(std::size_t i = 0; i < count; i++)
+                destination[histogram[(source[i].key >> shift) & 0xFF]++] = source[i];
+            std::swap(source, destination);
+        }
+        // If the last pass wrote into the scratch buffer, copy the result back
+        if(source != entries) std::memcpy(entries, source, count * sizeof(SortEntry<Key>));
+    }
+
+}
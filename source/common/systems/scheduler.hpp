@@ -0,0 +1,135 @@
+#pragma once
+
+#include "../ecs/component-type.hpp"
+#include "../thread-pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace our
+{
+
+    // The scheduler runs the systems of a state every frame on a thread pool.
+    // Each system declares the component types that it reads and writes. Two systems conflict if one of them writes
+    // a type that the other reads or writes, and the conflicting systems run in the order in which they were added.
+    // The systems that don't conflict run at the same time on the pool.
+    // The systems that must run on the main thread (e.g. the ones that use OpenGL or the window) are marked as such,
+    // and the main thread runs the pool jobs while it waits for them to become ready.
+    // Since "Transform" is not a component, it has its own bit (given by ComponentTypes) that stands for the local transforms.
+    class SystemScheduler {
+        struct SystemNode {
+            std::string name;
+            ComponentMask reads, writes;
+            bool mainThread;
+            std::function<void(float)> update;
+            // These are rebuilt every frame by "run"
+            std::vector<size_t> dependents; // The systems that must wait for this one
+            std::atomic<size_t> remainingDependencies{0};
+        };
+
+        ThreadPool* pool;
+        std::vector<std::unique_ptr<SystemNode>> systems;
+
+        // The main thread systems whose dependencies are done (filled by the pool threads)
+        std::mutex readyMutex;
+        std::vector<size_t> readyOnMainThread;
+        std::atomic<size_t> finishedCount{0};
+
+        void launch(size_t index, float deltaTime) {
+            if(systems[index]->mainThread){
+                std::lock_guard<std::mutex> lock(readyMutex);
+                readyOnMainThread.push_back(index);
+            } else {
+                pool->submit([this, index, deltaTime](){ execute(index, deltaTime); });
+            }
+        }
+
+        void execute(size_t index, float deltaTime) {
+            SystemNode& system = *systems[index];
+            system.update(deltaTime);
+            for(size_t dependent : system.dependents)
+                if(systems[dependent]->remainingDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                    launch(dependent, deltaTime);
+            finishedCount.fetch_add(1, std::memory_order_release);
+        }
+
+    public:
+        // Use this to declare that a system accesses all the component types (e.g. the renderer)
+        static constexpr ComponentMask ALL_COMPONENTS = ~ComponentMask(0);
+
+        // Returns the mask of the given component types (it can include "Transform")
+        template<typename... Ts>
+        static ComponentMask components() {
+            return (ComponentMask(0) | ... | ComponentTypes::mask<Ts>());
+        }
+
+        explicit SystemScheduler(ThreadPool* pool = nullptr) : pool(pool) {}
+
+        void setThreadPool(ThreadPool* pool) { this->pool = pool; }
+
+        // Adds a system that will be called every frame with the delta time
+        void add(const std::string& name, ComponentMask reads, ComponentMask writes, std::function<void(float)> update, bool mainThread = false) {
+            auto system = std::make_unique<SystemNode>();
+            system->name = name;
+            system->reads = reads;
+            system->writes = writes;
+            system->mainThread = mainThread;
+            system->update = std::move(update);
+            systems.push_back(std::move(system));
+        }
+
+        void clear() { systems.clear(); }
+
+        // Runs all the systems once and returns after all of them are done.
+        // This must be called from the main thread
+        void run(float deltaTime) {
+            // Build the dependency graph of this frame. A system depends on every earlier system that it conflicts with
+            for(size_t later = 0; later < systems.size(); later++){
+                SystemNode& system = *systems[later];
+                system.dependents.clear();
+                size_t dependencyCount = 0;
+                for(size_t earlier = 0; earlier < later; earlier++){
+                    SystemNode& other = *systems[earlier];
+                    if((other.writes & (system.reads | system.writes)) || (system.writes & other.reads)){
+                        other.dependents.push_back(later);
+                        dependencyCount++;
+                    }
+                }
+                system.remainingDependencies.store(dependencyCount, std::memory_order_relaxed);
+            }
+            // Without a pool, we run everything on the main thread in order
+            if(!pool){
+                for(auto& system : systems) system->update(deltaTime);
+                return;
+            }
+
+            finishedCount = 0;
+            readyOnMainThread.clear();
+            for(size_t index = 0; index < systems.size(); index++)
+                if(systems[index]->remainingDependencies.load(std::memory_order_relaxed) == 0)
+                    launch(index, deltaTime);
+
+            // The main thread runs its own systems as soon as they are ready and helps the pool in the meantime
+            while(finishedCount.load(std::memory_order_acquire) < systems.size()){
+                size_t index = systems.size();
+                {
+                    std::lock_guard<std::mutex> lock(readyMutex);
+                    if(!readyOnMainThread.empty()){
+                        // Take the earliest added system first to keep the order of the main thread systems
+                        auto earliest = std::min_element(readyOnMainThread.begin(), readyOnMainThread.end());
+                        index = *earliest;
+                        readyOnMainThread.erase(earliest);
+                    }
+                }
+                if(index < systems.size()) execute(index, deltaTime);
+                else if(!pool->runPendingJob()) std::this_thread::yield();
+            }
+        }
+    };
+
+}
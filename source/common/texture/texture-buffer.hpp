@@ -0,0 +1,86 @@
+#pragma once
+
+#include <string>
+#include <algorithm>
+
+#include <glad/gl.h>
+
+#include "../gl-state-cache.hpp"
+
+namespace our {
+
+    // The texture units of the texture buffers that are shared between all the shader programs.
+    // They are the last units so that they don't collide with the textures of the materials.
+    // Since GLSL 3.3 does not support "layout(binding = ...)", every program sets its samplers to these units when it is linked
+    #define TEXTURE_UNIT_LIGHT_DATA            13
+    #define TEXTURE_UNIT_CLUSTER_LIGHTS        14
+    #define TEXTURE_UNIT_CLUSTER_LIGHT_INDICES 15
+
+    // Returns the texture unit of the shared sampler with the given name, or -1 if the sampler is not a shared one
+    inline GLint getSharedTextureUnit(const std::string& samplerName) {
+        if(samplerName == "light_data") return TEXTURE_UNIT_LIGHT_DATA;
+        if(samplerName == "cluster_lights") return TEXTURE_UNIT_CLUSTER_LIGHTS;
+        if(samplerName == "cluster_light_indices") return TEXTURE_UNIT_CLUSTER_LIGHT_INDICES;
+        return -1;
+    }
+
+    // This class defines an OpenGL buffer texture (GL_TEXTURE_BUFFER), which is a buffer that shaders read with "texelFetch".
+    // Unlike a uniform buffer, its size is only limited by GL_MAX_TEXTURE_BUFFER_SIZE (at least 65536 texels),
+    // so it is used for the data that can grow with the scene (e.g. the lights and the light clusters).
+    class TextureBuffer {
+        // The OpenGL object names of the buffer and of the texture that views it
+        GLuint buffer, texture;
+        // The format of the texels (e.g. GL_RGBA32F or GL_R32UI)
+        GLenum format;
+        // The size of the buffer storage in bytes
+        GLsizeiptr capacity = 0;
+    public:
+        // Creates the buffer and the texture and attaches the buffer to the texture
+        explicit TextureBuffer(GLenum format) : format(format) {
+            glGenBuffers(1, &buffer);
+            glGenTextures(1, &texture);
+            // The attachment refers to the buffer object, so it stays valid when the buffer storage is reallocated
+            allocate(256);
+            // The texture stays bound to the active unit (the cache knows about it), so we don't need to unbind it
+            GLStateCache::bindTexture(GL_TEXTURE_BUFFER, texture);
+            glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+        }
+
+        ~TextureBuffer() {
+            GLStateCache::forgetTexture(texture);
+            glDeleteTextures(1, &texture);
+            glDeleteBuffers(1, &buffer);
+        }
+
+        // Allocates (or reallocates) the buffer storage to the given size in bytes. The content is left undefined
+        void allocate(GLsizeiptr size) {
+            capacity = size;
+            glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+            glBufferData(GL_TEXTURE_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+            glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        }
+
+        // Replaces the first "dataSize" bytes of the buffer with the given data. The storage grows (at least doubles) if it is too small.
+        // The old storage is orphaned first so that we don't wait for draw calls that still read the previous content
+        void update(const void* data, GLsizeiptr dataSize) {
+            if(dataSize > capacity) capacity = std::max(dataSize, capacity * 2);
+            glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+            glBufferData(GL_TEXTURE_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+            if(dataSize > 0) glBufferSubData(GL_TEXTURE_BUFFER, 0, dataSize, data);
+            glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        }
+
+        // Binds the texture to GL_TEXTURE_BUFFER of the given texture unit
+        void bind(GLuint unit) const {
+            GLStateCache::activeTexture(unit);
+            GLStateCache::bindTexture(GL_TEXTURE_BUFFER, texture);
+        }
+
+        GLenum getFormat() const { return format; }
+        GLsizeiptr getCapacity() const { return capacity; }
+
+        TextureBuffer(const TextureBuffer&) = delete;
+        TextureBuffer& operator=(const TextureBuffer&) = delete;
+    };
+
+}
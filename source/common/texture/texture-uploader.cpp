@@ -0,0 +1,130 @@
+#include "texture-uploader.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+// The buffers grow to at least this size so that the small images don't reallocate them one after the other
+#define MIN_STAGING_BUFFER_SIZE (1 << 20)
+
+namespace {
+    struct StagingBuffer {
+        GLuint buffer = 0;
+        GLsizeiptr capacity = 0;
+        void* mapped = nullptr; // Only used with persistent mapping
+        GLsync fence = nullptr;  // Signaled when the GPU is done reading the last upload from this buffer
+    };
+
+    StagingBuffer ring[TEXTURE_UPLOAD_RING_SIZE];
+    size_t nextBuffer = 0;
+
+    // Waits for the GPU to finish reading from the buffer, then binds it and makes sure it can hold "size" bytes
+    void prepare(StagingBuffer& staging, GLsizeiptr size, bool persistentMapping) {
+        if(staging.fence){
+            // The ring has several buffers, so the GPU is usually done with this one and this rarely waits
+            glClientWaitSync(staging.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+            glDeleteSync(staging.fence);
+            staging.fence = nullptr;
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging.buffer);
+        if(staging.buffer != 0 && size <= staging.capacity) return;
+
+        // The buffer is too small. The persistent storage is immutable, so the buffer is recreated in both cases
+        if(staging.mapped) glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        if(staging.buffer) glDeleteBuffers(1, &staging.buffer);
+        staging.capacity = std::max<GLsizeiptr>({size, 2 * staging.capacity, MIN_STAGING_BUFFER_SIZE});
+        staging.mapped = nullptr;
+        glGenBuffers(1, &staging.buffer);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging.buffer);
+        if(persistentMapping){
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_PIXEL_UNPACK_BUFFER, staging.capacity, nullptr, flags);
+            // If the mapping fails, "mapped" stays null and the buffer is mapped for each upload instead
+            staging.mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, staging.capacity, flags);
+        } else {
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, staging.capacity, nullptr, GL_STREAM_DRAW);
+        }
+    }
+}
+
+void our::TextureUploader::initialize(size_t budgetPerFrame) {
+    budget = budgetPerFrame;
+    persistentMapping = GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage;
+    immutableStorage = GLAD_GL_VERSION_4_2 || GLAD_GL_ARB_texture_storage;
+    nextBuffer = 0;
+    initialized = true;
+}
+
+void our::TextureUploader::destroy() {
+    for(auto& staging : ring){
+        if(staging.fence) glDeleteSync(staging.fence);
+        if(staging.mapped){
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging.buffer);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        }
+        if(staging.buffer) glDeleteBuffers(1, &staging.buffer);
+        staging = StagingBuffer();
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    initialized = false;
+}
+
+our::Texture2D* our::TextureUploader::upload(glm::ivec2 size, const void* pixels, bool generateMipmap) {
+    our::Texture2D* texture = new our::Texture2D();
+    texture->bind();
+
+    if(!initialized){
+        // There is no context to create the buffers with yet, so we fall back to the synchronous upload
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size.x, size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+        if(generateMipmap) glGenerateMipmap(GL_TEXTURE_2D);
+        return texture;
+    }
+
+    // A full mip chain goes down to 1x1, so it has floor(log2(largest side)) + 1 levels
+    GLsizei levels = 1;
+    if(generateMipmap)
+        for(int side = std::max(size.x, size.y); side > 1; side >>= 1) levels++;
+    if(immutableStorage){
+        glTexStorage2D(GL_TEXTURE_2D, levels, GL_RGBA8, size.x, size.y);
+    } else {
+        for(GLsizei level = 0; level < levels; level++)
+            glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, std::max(1, size.x >> level), std::max(1, size.y >> level), 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    }
+
+    // Copy the pixels into the next buffer of the ring then let the driver copy them into the texture
+    GLsizeiptr byteCount = (GLsizeiptr)size.x * size.y * 4;
+    StagingBuffer& staging = ring[nextBuffer];
+    nextBuffer = (nextBuffer + 1) % TEXTURE_UPLOAD_RING_SIZE;
+    prepare(staging, byteCount, persistentMapping);
+    bool staged = false;
+    if(staging.mapped){
+        std::memcpy(staging.mapped, pixels, byteCount);
+        staged = true;
+    } else {
+        // The fence was waited for, so the buffer can be written without synchronizing again
+        void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, byteCount,
+                                        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        if(mapped){
+            std::memcpy(mapped, pixels, byteCount);
+            // The content of the buffer is undefined if unmapping fails, so it is only used if this succeeds
+            staged = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+        }
+    }
+    if(staged){
+        // With a pixel unpack buffer bound, the last argument is an offset in the buffer
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, (const void*)0);
+        // The other uploads in the code pass client memory pointers, so the buffer must not stay bound
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        staging.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    } else {
+        // The buffer could not be written, so we upload from the client memory instead
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    }
+    if(levels > 1) glGenerateMipmap(GL_TEXTURE_2D);
+
+    frameBytes += (size_t)byteCount;
+    peakFrameBytes = std::max(peakFrameBytes, frameBytes);
+    totalBytes += (std::uint64_t)byteCount;
+    return texture;
+}
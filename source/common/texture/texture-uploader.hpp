@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <glad/gl.h>
+#include <glm/vec2.hpp>
+
+#include "texture2d.hpp"
+
+namespace our {
+
+    // The number of pixel unpack buffers that the uploads cycle through
+    #define TEXTURE_UPLOAD_RING_SIZE 4
+
+    // This static class uploads the pixels of the textures through a ring of pixel unpack buffers (PBOs).
+    // The pixels are copied into the next buffer of the ring and "glTexSubImage2D" reads them from there, so the copy to the texture
+    // is done by the driver in the background instead of stalling the calling thread like "glTexImage2D" from client memory.
+    // Each buffer is fenced after its upload and is only written again once the GPU is done reading it.
+    // If the driver supports ARB_buffer_storage, the buffers are mapped once (persistently) and written directly.
+    // If it supports ARB_texture_storage, the textures get immutable storage with all their mip levels allocated up-front.
+    // It also counts the uploaded bytes per frame, and "hasBudget" tells the streaming code whether it can upload more this frame.
+    class TextureUploader {
+        // The ring of buffers lives in "texture-uploader.cpp"
+        static inline bool initialized = false, persistentMapping = false, immutableStorage = false;
+        // The largest number of bytes uploaded per frame by the streaming code (0 means unlimited)
+        static inline size_t budget = 0;
+        static inline size_t frameBytes = 0, lastFrameBytes = 0, peakFrameBytes = 0;
+        static inline std::uint64_t totalBytes = 0;
+
+    public:
+        // Checks the supported extensions and sets the per frame budget in bytes (0 means unlimited).
+        // It must be called after the OpenGL functions are loaded. Until it is called, "upload" uses "glTexImage2D" directly
+        static void initialize(size_t budgetPerFrame);
+        // Deletes the buffers (it must be called while the OpenGL context still exists)
+        static void destroy();
+
+        // Creates a texture from RGBA8 pixels (the first row is the bottom of the image).
+        // If "generateMipmap" is true, the storage of all the mip levels is allocated and the levels are generated from the first level
+        static Texture2D* upload(glm::ivec2 size, const void* pixels, bool generateMipmap = true);
+
+        // Starts counting the bytes of a new frame (called once per frame by the application)
+        static void beginFrame() {
+            lastFrameBytes = frameBytes;
+            frameBytes = 0;
+        }
+        // Returns true if the uploads of this frame are still under the budget.
+        // The first upload of a frame is always allowed so that a texture larger than the budget can still be uploaded
+        static bool hasBudget() { return budget == 0 || frameBytes < budget; }
+
+        static size_t getBudget() { return budget; }
+        static void setBudget(size_t budgetPerFrame) { budget = budgetPerFrame; }
+        // The bytes uploaded in the current frame, in the last frame and in the frame that uploaded the most (so far)
+        static size_t getFrameBytes() { return frameBytes; }
+        static size_t getLastFrameBytes() { return lastFrameBytes; }
+        static size_t getPeakFrameBytes() { return peakFrameBytes; }
+        static std::uint64_t getTotalBytes() { return totalBytes; }
+    };
+
+}
@@ -1,4 +1,5 @@
 #include "texture-utils.hpp"
+#include "texture-uploader.hpp"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
@@ -17,12 +18,33 @@ our::Texture2D* our::texture_utils::empty(GLenum format, glm::ivec2 size){
     return texture;
 }
 
+our::Texture2D* our::texture_utils::empty(GLenum internalFormat, glm::ivec2 size, GLenum format, GLenum type){
+    our::Texture2D* texture = new our::Texture2D();
+    texture->bind();
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, size.x, size.y, 0, format, type, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    texture->unbind();
+
+    return texture;
+}
+
+our::texture_utils::Image::~Image() {
+    if(pixels) stbi_image_free(pixels);
+}
+
 our::Texture2D* our::texture_utils::loadImage(const std::string& filename, bool generate_mipmap) {
-    glm::ivec2 size;
+    Image image;
+    if(!decodeImage(filename, image)) return nullptr;
+    return createTexture(image, generate_mipmap);
+}
+
+bool our::texture_utils::decodeImage(const std::string& filename, Image& image) {
     int channels;
     //Since OpenGL puts the texture origin at the bottom left while images typically has the origin at the top left,
     //We need to till stb to flip images vertically after loading them
-    stbi_set_flip_vertically_on_load(true);
+    //(the setting is per thread since the images can be decoded on the thread pool)
+    stbi_set_flip_vertically_on_load_thread(true);
     //Load image data and retrieve width, height and number of channels in the image
     //The last argument is the number of channels we want and it can have the following values:
     //- 0: Keep number of channels the same as in the image file
@@ -31,31 +53,17 @@ our::Texture2D* our::texture_utils::loadImage(const std::string& filename, bool
     //- 3: RGB
     //- 4: RGB and Alpha (RGBA)
     //Note: channels (the 4th argument) always returns the original number of channels in the file
-    unsigned char* pixels = stbi_load(filename.c_str(), &size.x, &size.y, &channels, 4);
-    if(pixels == nullptr){
+    image.pixels = stbi_load(filename.c_str(), &image.size.x, &image.size.y, &channels, 4);
+    if(image.pixels == nullptr){
         std::cerr << "Failed to load image: " << filename << std::endl;
-        return nullptr;
+        return false;
     }
-    // Create a texture
-    our::Texture2D* texture = new our::Texture2D();
-    //Bind the texture such that we upload the image data to its storage
-    //TODO: (Req 5) Finish this function to fill the texture with the data found in "pixels"
-    texture->bind();
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size.x, size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
-    // 1. target (GL_TEXTURE_2D)
-    // 2. mipmap level (0)
-    // 3. internal format (GL_RGBA)
-    // 4. width (size.x)
-    // 5. height (size.y)
-    // 6. border (0)
-    // 7. format (GL_RGBA)
-    // 8. type (GL_UNSIGNED_BYTE)
-    // 9. data (pixels)
-    
-    if(generate_mipmap){ // if true then generate the mipmap
-        glGenerateMipmap(GL_TEXTURE_2D);
-    }
-    ////////////////////////////////////////////////////////////////////////////////////////////
-    stbi_image_free(pixels); //Free image data after uploading to GPU
-    return texture;
+    return true;
+}
+
+our::Texture2D* our::texture_utils::createTexture(const Image& image, bool generate_mipmap) {
+    // The pixels are staged in a pixel unpack buffer and copied into the texture by the driver (see "TextureUploader"),
+    // then the mip levels are generated from the first level if "generate_mipmap" is true
+    // The image data is freed by the owner of "image" since it is copied into the staging buffer
+    return TextureUploader::upload(image.size, image.pixels, generate_mipmap);
 }
\ No newline at end of file
@@ -7,8 +7,25 @@
 #include <glm/vec2.hpp>
 
 namespace our::texture_utils {
+    // The pixels of an image decoded on the CPU (always RGBA with 8 bits per channel and the first row at the bottom)
+    struct Image {
+        glm::ivec2 size = glm::ivec2(0);
+        unsigned char* pixels = nullptr;
+
+        Image() = default;
+        ~Image();
+        Image(const Image&) = delete;
+        Image& operator=(const Image&) = delete;
+    };
+
     // This function create an empty texture with a specific format (useful for framebuffers)
     Texture2D* empty(GLenum format, glm::ivec2 size);
+    // The same as above but the internal format can differ from the pixel format (e.g. GL_RGBA16F with GL_RGBA and GL_HALF_FLOAT)
+    Texture2D* empty(GLenum internalFormat, glm::ivec2 size, GLenum format, GLenum type);
     // This function loads an image and sends its data to the given Texture2D 
     Texture2D* loadImage(const std::string& filename, bool generate_mipmap = true);
+    // This function reads and decodes an image file. It does not call OpenGL so it can run on any thread. Returns false on failure
+    bool decodeImage(const std::string& filename, Image& image);
+    // This function creates a texture from a decoded image (it must be called on the thread of the OpenGL context)
+    Texture2D* createTexture(const Image& image, bool generate_mipmap = true);
 }
\ No newline at end of file
@@ -2,6 +2,8 @@
 
 #include <glad/gl.h>
 
+#include "../gl-state-cache.hpp"
+
 namespace our {
 
     // This class defined an OpenGL texture which will be used as a GL_TEXTURE_2D
@@ -21,6 +23,7 @@ namespace our {
             //TODO: (Req 5) Complete this function
             glDeleteTextures(1, &name);
             // 1 is the number of texture names to be deleted
+            GLStateCache::forgetTexture(name);
         }
 
         // Get the internal OpenGL name of the texture which is useful for use with framebuffers
@@ -29,9 +32,10 @@ namespace our {
         }
 
         // This method binds this texture to GL_TEXTURE_2D
+        // (it does nothing if the texture is already bound to the active texture unit, see "GLStateCache")
         void bind() const {
             //TODO: (Req 5) Complete this function
-            glBindTexture(GL_TEXTURE_2D, name);
+            GLStateCache::bindTexture2D(name);
         }
 
         /*void bind(GLuint passedname)
@@ -43,7 +47,7 @@ namespace our {
         // This static method ensures that no texture is bound to GL_TEXTURE_2D
         static void unbind(){
             //TODO: (Req 5) Complete this function
-            glBindTexture(GL_TEXTURE_2D, 0);
+            GLStateCache::bindTexture2D(0);
             // 0 to unbind the texture
         }
 
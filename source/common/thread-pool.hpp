@@ -0,0 +1,222 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace our {
+
+    // Counts the unfinished jobs that were submitted with it so that they can be waited for (see "ThreadPool::wait")
+    class JobGroup {
+        std::atomic<size_t> pending{0};
+        friend class ThreadPool;
+    public:
+        bool isDone() const { return pending.load(std::memory_order_acquire) == 0; }
+    };
+
+    // A pool of worker threads that run jobs. Each thread has its own queue of jobs: a thread pushes and pops the jobs
+    // from the back of its own queue (so nested jobs run while their data is still hot in the cache) and when its queue
+    // is empty, it steals the oldest job from the front of the other queues (work stealing).
+    // The thread that waits for a group of jobs doesn't sleep, it runs the queued jobs until the group is done,
+    // so the calling thread (usually the main thread) counts as one of the threads of the pool.
+    // Long jobs that nobody waits for within a frame (e.g. loading assets) are submitted as background jobs (see "submitBackground"),
+    // which only the workers run when they have nothing else to do, so a frame never stalls on them.
+    // NOTE: Jobs must not call OpenGL since the context is only current on the main thread.
+    class ThreadPool {
+        struct Job {
+            std::function<void()> function;
+            JobGroup* group;
+        };
+        struct JobQueue {
+            std::mutex mutex;
+            std::deque<Job> jobs;
+        };
+
+        // The queue 0 is shared by the threads that are not workers of this pool (e.g. the main thread),
+        // while the queue "i" (i > 0) belongs to the worker thread "i - 1"
+        std::vector<std::unique_ptr<JobQueue>> queues;
+        std::vector<std::thread> workers;
+        JobQueue backgroundQueue; // The background jobs run in the order they were submitted
+        std::atomic<size_t> queuedCount{0}; // The number of jobs in all the queues (except the background queue)
+        std::atomic<size_t> backgroundCount{0}; // The number of jobs in the background queue
+        std::atomic<size_t> nextQueue{0};   // Used to spread the jobs submitted from outside over the queues
+        std::atomic<bool> stopping{false};
+        std::mutex sleepMutex;
+        std::condition_variable wakeUp; // Idle workers sleep on this until a job is submitted
+
+        // The pool that the current thread works for and the index of the thread's queue in it
+        static inline thread_local ThreadPool* currentPool = nullptr;
+        static inline thread_local size_t currentQueue = 0;
+
+        size_t getCallerQueue() const { return currentPool == this ? currentQueue : 0; }
+
+        bool pop(size_t index, Job& job) {
+            JobQueue& queue = *queues[index];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if(queue.jobs.empty()) return false;
+            job = std::move(queue.jobs.back());
+            queue.jobs.pop_back();
+            return true;
+        }
+
+        bool steal(size_t index, Job& job) {
+            JobQueue& queue = *queues[index];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if(queue.jobs.empty()) return false;
+            job = std::move(queue.jobs.front());
+            queue.jobs.pop_front();
+            return true;
+        }
+
+        // Takes a job from the given queue or steals one from the other queues then runs it
+        bool runOneJob(size_t index) {
+            if(queuedCount.load(std::memory_order_acquire) == 0) return false;
+            Job job;
+            bool found = pop(index, job);
+            for(size_t offset = 1; !found && offset < queues.size(); offset++)
+                found = steal((index + offset) % queues.size(), job);
+            if(!found) return false;
+            queuedCount.fetch_sub(1, std::memory_order_acq_rel);
+            job.function();
+            if(job.group) job.group->pending.fetch_sub(1, std::memory_order_acq_rel);
+            return true;
+        }
+
+        void workerLoop(size_t index) {
+            currentPool = this;
+            currentQueue = index;
+            while(true){
+                if(runOneJob(index) || runBackgroundJob()) continue;
+                std::unique_lock<std::mutex> lock(sleepMutex);
+                wakeUp.wait(lock, [this](){ return stopping.load() || queuedCount.load() > 0 || backgroundCount.load() > 0; });
+                if(stopping.load() && queuedCount.load() == 0 && backgroundCount.load() == 0) return;
+            }
+        }
+
+        void notifyWorker() {
+            // Taking the lock makes sure that a worker can't miss the notification between checking the count and sleeping
+            { std::lock_guard<std::mutex> lock(sleepMutex); }
+            wakeUp.notify_one();
+        }
+
+    public:
+        // Creates a pool that runs the jobs on "threadCount" threads (including the thread that waits for the jobs).
+        // If "threadCount" is 0, the number of hardware threads is used
+        explicit ThreadPool(unsigned threadCount = 0) {
+            if(threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+            for(unsigned index = 0; index < threadCount; index++)
+                queues.push_back(std::make_unique<JobQueue>());
+            for(unsigned index = 1; index < threadCount; index++)
+                workers.emplace_back(&ThreadPool::workerLoop, this, index);
+        }
+
+        ~ThreadPool() {
+            {
+                std::lock_guard<std::mutex> lock(sleepMutex);
+                stopping = true;
+            }
+            wakeUp.notify_all();
+            for(auto& worker : workers) worker.join();
+        }
+
+        // Returns the number of threads that run jobs (the workers and the waiting thread)
+        size_t getThreadCount() const { return queues.size(); }
+
+        // Adds a job to the pool. If a group is given, the job is counted in it until it finishes
+        void submit(std::function<void()> function, JobGroup* group = nullptr) {
+            if(group) group->pending.fetch_add(1, std::memory_order_relaxed);
+            size_t index = currentPool == this ? currentQueue : nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+            {
+                std::lock_guard<std::mutex> lock(queues[index]->mutex);
+                queues[index]->jobs.push_back({std::move(function), group});
+            }
+            queuedCount.fetch_add(1, std::memory_order_release);
+            notifyWorker();
+        }
+
+        // Adds a background job to the pool. It is only run by the workers when their queues are empty, by "waitBackground"
+        // or by "runBackgroundJob" (which a pool without workers must call, e.g. once per frame, for the background jobs to progress)
+        void submitBackground(std::function<void()> function, JobGroup* group = nullptr) {
+            if(group) group->pending.fetch_add(1, std::memory_order_relaxed);
+            {
+                std::lock_guard<std::mutex> lock(backgroundQueue.mutex);
+                backgroundQueue.jobs.push_back({std::move(function), group});
+            }
+            backgroundCount.fetch_add(1, std::memory_order_release);
+            notifyWorker();
+        }
+
+        // Runs one of the queued jobs on the calling thread. Returns false if there was no job to run
+        bool runPendingJob() { return runOneJob(getCallerQueue()); }
+
+        // Runs the oldest background job on the calling thread. Returns false if there was no background job to run
+        bool runBackgroundJob() {
+            if(backgroundCount.load(std::memory_order_acquire) == 0) return false;
+            Job job;
+            {
+                std::lock_guard<std::mutex> lock(backgroundQueue.mutex);
+                if(backgroundQueue.jobs.empty()) return false;
+                job = std::move(backgroundQueue.jobs.front());
+                backgroundQueue.jobs.pop_front();
+            }
+            backgroundCount.fetch_sub(1, std::memory_order_acq_rel);
+            job.function();
+            if(job.group) job.group->pending.fetch_sub(1, std::memory_order_acq_rel);
+            return true;
+        }
+
+        // Returns true if there are background jobs that didn't start yet
+        bool hasBackgroundJobs() const { return backgroundCount.load(std::memory_order_acquire) > 0; }
+
+        // Runs the queued jobs on the calling thread until all the jobs of the group are done.
+        // The background jobs are not run here since the caller is usually in the middle of a frame
+        void wait(const JobGroup& group) {
+            while(!group.isDone())
+                if(!runPendingJob()) std::this_thread::yield();
+        }
+
+        // The same as "wait" but the calling thread also runs the background jobs (use it for a group of background jobs)
+        void waitBackground(const JobGroup& group) {
+            while(!group.isDone())
+                if(!runPendingJob() && !runBackgroundJob()) std::this_thread::yield();
+        }
+
+        // Returns the size of the chunks used by "parallelFor" to split "count" items.
+        // The chunks are at least "minChunkSize" long and there are about 4 chunks per thread so that
+        // the threads that finish early can steal the remaining chunks.
+        size_t getChunkSize(size_t count, size_t minChunkSize) const {
+            if(getThreadCount() == 1) return std::max<size_t>(count, 1);
+            return std::max<size_t>({minChunkSize, (count + 4 * getThreadCount() - 1) / (4 * getThreadCount()), 1});
+        }
+
+        // Splits the range [0, count) into chunks (see "getChunkSize") and calls "function(begin, end)" for each chunk
+        // on the pool, then waits for all of them. The calling thread runs the first chunk itself.
+        // Since the chunks always start at a multiple of the chunk size, "begin / chunkSize" can be used as a chunk index.
+        template<typename F>
+        void parallelFor(size_t count, size_t minChunkSize, F&& function) {
+            if(count == 0) return;
+            size_t chunkSize = getChunkSize(count, minChunkSize);
+            if(chunkSize >= count){
+                function(size_t(0), count);
+                return;
+            }
+            JobGroup group;
+            for(size_t begin = chunkSize; begin < count; begin += chunkSize){
+                size_t end = std::min(begin + chunkSize, count);
+                submit([&function, begin, end](){ function(begin, end); }, &group);
+            }
+            function(size_t(0), chunkSize);
+            wait(group);
+        }
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+    };
+
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <ecs/world.hpp>
+#include <components/movement.hpp>
+#include <components/mesh-renderer.hpp>
+#include <systems/movement.hpp>
+#include <thread-pool.hpp>
+#include <application.hpp>
+
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+
+// This state measures the per-frame cost of the ECS operations used by the systems on a large world.
+// It spawns "entityCount" entities (all of them moving and half of them with a mesh renderer) then
+// prints the average time of each operation every "reportEvery" frames. Nothing is drawn.
+// The movement system is also run on thread pools of each size in "threadCounts" to measure how it scales.
+// For example, run: "GAME_APPLICATION -c config/ecs-benchmark/100k.jsonc -f 600"
+class EcsBenchmarkState: public our::State {
+
+    our::World world;
+    our::MovementSystem movementSystem;
+    int reportEvery;
+    int frames;
+
+    // The accumulated time (in milliseconds) of each measured operation since the last report
+    double movementQueryTime, movementScanTime, gatherQueryTime, gatherScanTime, transformsTime;
+    // A thread pool for each measured thread count and the accumulated time of the parallel movement on it
+    std::vector<std::unique_ptr<our::ThreadPool>> threadPools;
+    std::vector<double> movementParallelTimes;
+
+    // Runs the given function and returns the time it took in milliseconds
+    template<typename F>
+    static double measure(F&& function) {
+        auto start = std::chrono::high_resolution_clock::now();
+        function();
+        auto end = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration<double, std::milli>(end - start).count();
+    }
+
+    void onInitialize() override {
+        auto& config = getApp()->getConfig()["scene"];
+        int entityCount = config.value("entityCount", 10000);
+        reportEvery = config.value("reportEvery", 120);
+        for(int i = 0; i < entityCount; i++){
+            our::Entity* entity = world.add();
+            entity->parent = nullptr;
+            entity->localTransform.position = glm::vec3(i % 100, (i / 100) % 100, i / 10000);
+            auto movement = entity->addComponent<our::MovementComponent>();
+            movement->linearVelocity = glm::vec3(0, 0.1f, 0);
+            movement->angularVelocity = glm::vec3(0, 1.0f, 0);
+            if(i % 2 == 0){
+                auto meshRenderer = entity->addComponent<our::MeshRendererComponent>();
+                meshRenderer->mesh = nullptr;
+                meshRenderer->material = nullptr;
+            }
+        }
+        threadPools.clear();
+        for(unsigned threadCount : config.value("threadCounts", std::vector<unsigned>{1, 2, 4, 8}))
+            threadPools.push_back(std::make_unique<our::ThreadPool>(threadCount));
+        movementParallelTimes.assign(threadPools.size(), 0.0);
+        frames = 0;
+        movementQueryTime = movementScanTime = gatherQueryTime = gatherScanTime = transformsTime = 0;
+        std::cout << "ECS benchmark with " << entityCount << " entities" << std::endl;
+    }
+
+    void onDraw(double deltaTime) override {
+        float dt = (float)deltaTime;
+        // The movement system uses a query over the movement components
+        movementQueryTime += measure([&](){ movementSystem.update(&world, dt); });
+        // The same work done by scanning all the entities and probing each one for its component
+        movementScanTime += measure([&](){
+            for(auto entity : world.getEntities()){
+                if(auto movement = entity->getComponent<our::MovementComponent>(); movement){
+                    entity->localTransform.position -= dt * movement->linearVelocity;
+                    entity->localTransform.rotation -= dt * movement->angularVelocity;
+                }
+            }
+        });
+        // The same query split into chunks on each thread pool (alternating the direction to keep the entities in place)
+        for(size_t index = 0; index < threadPools.size(); index++){
+            float direction = index % 2 == 0 ? 1.0f : -1.0f;
+            movementParallelTimes[index] += measure([&](){ movementSystem.update(&world, direction * dt, threadPools[index].get()); });
+        }
+        transformsTime += measure([&](){ world.updateTransforms(); });
+        // The renderer gathers the world matrices of the entities that have a mesh renderer
+        glm::vec3 sum(0.0f);
+        gatherQueryTime += measure([&](){
+            for(auto [meshRenderer, entity] : world.query<our::MeshRendererComponent, our::Entity>())
+                sum += glm::vec3(entity->getLocalToWorldMatrix()[3]);
+        });
+        gatherScanTime += measure([&](){
+            for(auto entity : world.getEntities())
+                if(auto meshRenderer = entity->getComponent<our::MeshRendererComponent>(); meshRenderer)
+                    sum -= glm::vec3(entity->getLocalToWorldMatrix()[3]);
+        });
+
+        if(++frames == reportEvery){
+            std::cout << std::fixed << std::setprecision(3)
+                      << "Average per frame (ms) over " << frames << " frames:"
+                      << " movement query " << movementQueryTime / frames
+                      << ", movement scan " << movementScanTime / frames
+                      << ", update transforms " << transformsTime / frames
+                      << ", gather query " << gatherQueryTime / frames
+                      << ", gather scan " << gatherScanTime / frames
+                      << " (checksum " << sum.x + sum.y + sum.z << ")" << std::endl;
+            std::cout << "Parallel movement (ms):";
+            for(size_t index = 0; index < threadPools.size(); index++){
+                std::cout << " " << threadPools[index]->getThreadCount() << " threads " << movementParallelTimes[index] / frames;
+                movementParallelTimes[index] = 0;
+            }
+            std::cout << std::endl;
+            frames = 0;
+            movementQueryTime = movementScanTime = gatherQueryTime = gatherScanTime = transformsTime = 0;
+        }
+    }
+
+    void onDestroy() override {
+        threadPools.clear();
+        world.clear();
+    }
+};
@@ -26,7 +26,7 @@ class EntityTestState: public our::State {
         auto& config = getApp()->getConfig()["scene"];
         // If we have assets in the scene config, we deserialize them
         if(config.contains("assets")){
-            our::deserializeAllAssets(config["assets"]);
+            our::deserializeAllAssets(config["assets"], &getApp()->getThreadPool());
         }
 
         // If we have a world in the scene config, we use it to populate our world
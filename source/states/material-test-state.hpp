@@ -22,7 +22,7 @@ class MaterialTestState: public our::State {
         auto& config = getApp()->getConfig()["scene"];
         // If we have assets in the scene config, we deserialize them
         if(config.contains("assets")){
-            our::deserializeAllAssets(config["assets"]);
+            our::deserializeAllAssets(config["assets"], &getApp()->getThreadPool());
         }
         // We get the mesh and the material from AssetLoader 
         mesh = our::AssetLoader<our::Mesh>::get("mesh");
@@ -6,6 +6,7 @@
 #include <systems/forward-renderer.hpp>
 #include <systems/free-camera-controller.hpp>
 #include <systems/movement.hpp>
+#include <systems/scheduler.hpp>
 #include <asset-loader.hpp>
 
 //TODO: (Game) Implement Win State
@@ -17,13 +18,15 @@ class Playstate: public our::State {
     our::ForwardRenderer renderer;
     our::FreeCameraControllerSystem cameraController;
     our::MovementSystem movementSystem;
+    our::SystemScheduler scheduler;
 
     void onInitialize() override {
         // First of all, we get the scene configuration from the app config
         auto& config = getApp()->getConfig()["scene"];
         // If we have assets in the scene config, we deserialize them
+        // With "streamAssets", the textures and the meshes keep loading in the background while the first frames are drawn with placeholders
         if(config.contains("assets")){
-            our::deserializeAllAssets(config["assets"]);
+            our::deserializeAllAssets(config["assets"], &getApp()->getThreadPool(), config.value("streamAssets", false));
         }
         // If we have a world in the scene config, we use it to populate our world
         if(config.contains("world")){
@@ -34,14 +37,29 @@ class Playstate: public our::State {
         // Then we initialize the renderer
         auto size = getApp()->getFrameBufferSize();
         renderer.initialize(size, config["renderer"]);
+
+        // The systems declare the components they read and write so that the scheduler knows which ones can run together.
+        // The camera controller uses the window and the renderer uses OpenGL so they must run on the main thread.
+        using Scheduler = our::SystemScheduler;
+        auto& threadPool = getApp()->getThreadPool();
+        scheduler.setThreadPool(&threadPool);
+        scheduler.add("movement",
+            Scheduler::components<our::MovementComponent>(), Scheduler::components<our::Transform>(),
+            [this, &threadPool](float deltaTime){ movementSystem.update(&world, deltaTime, &threadPool); });
+        scheduler.add("camera-controller",
+            Scheduler::components<our::CameraComponent, our::FreeCameraControllerComponent, our::CollisionComponent>(),
+            Scheduler::components<our::Transform>(),
+            [this](float deltaTime){ cameraController.update(&world, deltaTime); }, true);
+        // The renderer reads everything and updates the cached world matrices.
+        // It gathers the render commands on the thread pool but issues the draw calls from the main thread
+        scheduler.add("renderer",
+            Scheduler::ALL_COMPONENTS, Scheduler::components<our::Transform>(),
+            [this, &threadPool](float){ renderer.render(&world, &threadPool); }, true);
     }
 
     void onDraw(double deltaTime) override {
-        // Here, we just run a bunch of systems to control the world logic
-        movementSystem.update(&world, (float)deltaTime);
-        cameraController.update(&world, (float)deltaTime);
-        // And finally we use the renderer system to draw the scene
-        renderer.render(&world);
+        // Here, we run the systems that control the world logic and finally the renderer to draw the scene
+        scheduler.run((float)deltaTime);
 
         // Get a reference to the keyboard object
         auto& keyboard = getApp()->getKeyboard();
@@ -53,6 +71,7 @@ class Playstate: public our::State {
     }
 
     void onDestroy() override {
+        scheduler.clear();
         // Don't forget to destroy the renderer
         renderer.destroy();
         // On exit, we call exit for the camera controller system to make sure that the mouse is unlocked
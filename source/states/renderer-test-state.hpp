@@ -5,6 +5,7 @@
 #include <components/camera.hpp>
 #include <components/mesh-renderer.hpp>
 #include <systems/forward-renderer.hpp>
+#include <texture/texture-uploader.hpp>
 #include <application.hpp>
 
 // This state tests and shows how to use the Forward renderer.
@@ -12,13 +13,19 @@ class RendererTestState: public our::State {
 
     our::World world;
     our::ForwardRenderer renderer;
+    // The sums of the opaque pass statistics over the frames (used to compare the renderer options, e.g. "depthPrepass")
+    std::uint64_t shadedSamplesSum = 0, gpuTimeSum = 0;
+    size_t measuredFrameCount = 0;
+    // If "showStatistics" is true in the scene config, the statistics of the renderer are shown in an ImGui window
+    bool showStatistics = false;
     
     void onInitialize() override {
         // First of all, we get the scene configuration from the app config
         auto& config = getApp()->getConfig()["scene"];
         // If we have assets in the scene config, we deserialize them
+        // With "streamAssets", the textures and the meshes keep loading in the background while the first frames are drawn with placeholders
         if(config.contains("assets")){
-            our::deserializeAllAssets(config["assets"]);
+            our::deserializeAllAssets(config["assets"], &getApp()->getThreadPool(), config.value("streamAssets", false));
         }
 
         // If we have a world in the scene config, we use it to populate our world
@@ -28,11 +35,47 @@ class RendererTestState: public our::State {
 
         glm::ivec2 size = getApp()->getFrameBufferSize();
         renderer.initialize(size, config["renderer"]);
+        showStatistics = config.value("showStatistics", false);
     }
 
     void onDraw(double deltaTime) override {
         // We simply call the renderer's "render" function and it should do all the rendering work
         renderer.render(&world);
+        const our::RenderStatistics& statistics = renderer.getStatistics();
+        if(statistics.opaqueGPUTime > 0){
+            shadedSamplesSum += statistics.opaqueShadedSamples;
+            gpuTimeSum += statistics.opaqueGPUTime;
+            measuredFrameCount++;
+        }
+    }
+
+    void onImmediateGui() override {
+        if(!showStatistics) return;
+        const our::RenderStatistics& statistics = renderer.getStatistics();
+        ImGui::Begin("Renderer Statistics");
+        ImGui::Text("Commands: %zu visible, %zu culled", statistics.visibleCount, statistics.culledCount);
+        // The memory used by the per-frame arrays of the renderer in the last frame and at most
+        ImGui::Text("Frame memory: %zu bytes (peak: %zu bytes)", statistics.frameBytes, statistics.peakFrameBytes);
+        ImGui::Text("Lights: %zu, light indices in the clusters: %zu", statistics.lightCount, statistics.lightIndexCount);
+        // The state calls and the texture/sampler binds sent to OpenGL or skipped by the state cache (see "GLStateCache")
+        ImGui::Text("State calls: %llu issued, %llu skipped", (unsigned long long)statistics.stateCache.issued,
+                    (unsigned long long)statistics.stateCache.skipped);
+        ImGui::Text("Texture binds: %llu issued, %llu skipped", (unsigned long long)statistics.stateCache.binds,
+                    (unsigned long long)statistics.stateCache.skippedBinds);
+        // The averages of the opaque pass since the state started
+        if(measuredFrameCount > 0){
+            ImGui::Text("Opaque pass average over %zu frames: %llu shaded samples, %.1f us", measuredFrameCount,
+                        (unsigned long long)(shadedSamplesSum / measuredFrameCount), gpuTimeSum / measuredFrameCount / 1000.0);
+        }
+        // The time it took to load the assets of the scene (and to stream the textures and the meshes if they are streamed)
+        const our::AssetLoadingStatistics& loading = our::getAssetLoadingStatistics();
+        ImGui::Text("Assets: loaded in %.1f ms%s", loading.loadTime, loading.threaded ? " (on the thread pool)" : "");
+        if(loading.streamed){
+            if(our::isStreamingAssets()) ImGui::Text("Streaming the textures and the meshes...");
+            else ImGui::Text("Streamed the textures and the meshes in %.1f ms", loading.streamTime);
+            ImGui::Text("Texture uploads: at most %zu bytes in a frame", our::TextureUploader::getPeakFrameBytes());
+        }
+        ImGui::End();
     }
 
     void onDestroy() override {
@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <flags/flags.h>
+
+#include <mesh/mesh-cache.hpp>
+#include <mesh/mesh-utils.hpp>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// Writes the binary cache files of ".obj" files ahead of time so that the application never parses them at runtime.
+// Usage: MESH_BAKE [files...] [-o cache/directory] [--benchmark] [-n iterations]
+// If no file is given, all the ".obj" files in "assets/models" are baked.
+// The options must come after the files since the argument parser treats the token after an option as its value.
+// With "--benchmark", it also measures the time it takes to load each mesh from the ".obj" file and from its cache file
+// (up to the point where the data would be handed to glBufferData, which needs a GL context and is the same in both cases)
+// and the peak memory of the process, which is reached while parsing the largest ".obj" file.
+
+// Returns the average time in milliseconds of "function" over "iterations" runs
+template<typename F>
+static double measure(int iterations, F&& function) {
+    auto start = std::chrono::steady_clock::now();
+    for(int iteration = 0; iteration < iterations; iteration++) function();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+}
+
+// Returns the largest amount of physical memory (in bytes) used by the process so far, or 0 if it is not available
+static size_t getPeakMemory() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if(K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return counters.PeakWorkingSetSize;
+    return 0;
+#else
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return (size_t)usage.ru_maxrss; // macOS reports bytes
+#else
+    return (size_t)usage.ru_maxrss * 1024; // Linux reports kilobytes
+#endif
+#endif
+}
+
+int main(int argc, char** argv) {
+    flags::args args(argc, argv);
+    std::string directory = args.get<std::string>("o", MESH_CACHE_DIRECTORY);
+    bool benchmark = args.get<bool>("benchmark", false);
+    int iterations = std::max(1, args.get<int>("n", 20));
+
+    std::vector<std::string> files;
+    for(const auto& file : args.positional()) files.emplace_back(file);
+    if(files.empty()){
+        std::error_code ec;
+        for(const auto& entry : std::filesystem::directory_iterator("assets/models", ec))
+            if(entry.path().extension() == ".obj") files.push_back(entry.path().string());
+    }
+    if(files.empty()){
+        std::cerr << "No \".obj\" file to bake" << std::endl;
+        return -1;
+    }
+
+    int failures = 0;
+    for(const auto& file : files){
+        std::string content;
+        our::MeshData data;
+        if(!our::mesh_cache::readFile(file, content) || !our::mesh_utils::parseOBJ(content, file, data)){
+            std::cerr << "Failed to bake \"" << file << "\"" << std::endl;
+            failures++;
+            continue;
+        }
+        data.computeBounds();
+        std::uint64_t hash = our::mesh_cache::hashBytes(content.data(), content.size());
+        std::string cachePath = our::mesh_cache::getCachePath(file, hash, directory);
+        if(!our::mesh_cache::write(cachePath, hash, data)){
+            std::cerr << "Failed to write \"" << cachePath << "\"" << std::endl;
+            failures++;
+            continue;
+        }
+        std::cout << file << " -> " << cachePath << " (" << data.vertices.size() << " vertices, "
+                  << data.elements.size() << " elements, " << data.submeshes.size() << " submeshes)" << std::endl;
+
+        if(!benchmark) continue;
+        // Both paths start from the path of the ".obj" file and end with the vertices and the elements in memory.
+        // The data is copied into a staging vector to stand in for the upload, which makes the mapped pages actually load
+        std::vector<char> staging;
+        auto upload = [&staging](const void* vertices, size_t vertexCount, const void* elements, size_t elementCount){
+            size_t verticesSize = vertexCount * sizeof(our::Vertex), elementsSize = elementCount * sizeof(std::uint32_t);
+            staging.resize(verticesSize + elementsSize);
+            std::memcpy(staging.data(), vertices, verticesSize);
+            std::memcpy(staging.data() + verticesSize, elements, elementsSize);
+        };
+        double objTime = measure(iterations, [&](){
+            std::string objContent;
+            our::MeshData objData;
+            our::mesh_cache::readFile(file, objContent);
+            our::mesh_utils::parseOBJ(objContent, file, objData);
+            objData.computeBounds();
+            upload(objData.vertices.data(), objData.vertices.size(), objData.elements.data(), objData.elements.size());
+        });
+        double cacheTime = measure(iterations, [&](){
+            std::string objContent;
+            our::mesh_cache::readFile(file, objContent);
+            std::uint64_t objHash = our::mesh_cache::hashBytes(objContent.data(), objContent.size());
+            our::MappedMeshCache cache;
+            if(cache.open(our::mesh_cache::getCachePath(file, objHash, directory), objHash))
+                upload(cache.vertices, cache.header->vertexCount, cache.elements, cache.header->elementCount);
+        });
+        std::cout << "    OBJ: " << objTime << " ms, cache: " << cacheTime << " ms (" << objTime / cacheTime << "x faster, average of "
+                  << iterations << " loads)" << std::endl;
+    }
+    if(benchmark) std::cout << "Peak memory: " << getPeakMemory() / (1024 * 1024) << " MiB" << std::endl;
+    return failures == 0 ? 0 : -1;
+}